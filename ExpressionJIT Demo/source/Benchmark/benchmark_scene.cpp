@@ -1,96 +1,324 @@
-#include "benchmark_scene.h"
-#include <imgui/imgui.h>
-#include <exprjit/x86_64.h>
-#include <exprjit/binary_encoder.h>
-#include <exprjit/function.h>
-#include <exprjit/parser.h>
-#include <exprjit/jit.h>
-#include <exprjit/data_type.h>
-#include <exprjit/ir.h>
-#include <exprjit/ir_generator.h>
-#include <exprjit/ir_optimizer.h>
-
-namespace ed
-{
-	double(* volatile bench_fun_aot )( double ) = [](double x) { return 18 - x * ( 3.14 - abs(x) + floor(x * abs(x - 5)) ); };
-	const char* bench_fun_src = "18 - x * (3.14 - abs x + floor (x * abs(x - 5)))";
-
-	void BenchmarkScene::initialize() {
-		{
-			std::vector<unsigned char> binary;
-			std::unordered_map<char, std::pair<unsigned, exprjit::DataType>> argmap {
-				{ 'x', { 0, exprjit::DataType::Float } }
-			};
-
-			evo::Timer timer;
-			size_t ei = exprjit::Parser(bench_fun_src, m_expression, argmap)( );
-			m_timeParse = timer.time<double>();
-			timer.reset();
-			exprjit::ir::Generator(m_expression, ei, m_instructions, exprjit::DataType::Float)();
-			exprjit::ir::Optimizer opt(m_instructions);
-			opt();
-			exprjit::ir::jit(m_instructions, make_unique<exprjit::X86_64>(binary, 0, 1));
-			m_function = std::make_unique<exprjit::Function<double(double)>>(binary);
-			m_timeJIT = timer.time<double>();
-
-			m_interpreter_rec = std::make_unique<RecursiveInterpreter>(m_expression, ei);
-			m_interpreter_stk = std::make_unique<StackInterpreter>(m_expression, ei);
-			m_interpreter_ir = std::make_unique<IRInterpreter>(m_instructions);
-		}
-	}
-
-	template<typename F>
-	double bench(int count, F&& f) {
-		double arg = rand() * 0.00147;
-		evo::Timer timer;
-		for (int i = 0; i < count; ++i) volatile double res = f(arg);
-		return timer.time<double>();
-	}
-
-	void BenchmarkScene::gui() {
-		constexpr const char* flfrmt = "%9.7f";
-		static int evaluations = 1000;
-		static int repetitions = 4;
-
-		ImGui::Begin("Expression JIT Demo Benchmark");
-		ImGui::Text(bench_fun_src);
-		ImGui::LabelText("Time parsing", flfrmt, m_timeParse);
-		ImGui::LabelText("Time compiling", flfrmt, m_timeComp);
-		ImGui::Separator();
-		ImGui::InputInt("Evaluations", &evaluations);
-		ImGui::InputInt("Repetitions", &repetitions);
-
-		if (ImGui::Button("Run")) {
-			const auto apt = [this]() {
-				m_timeAOT += bench(evaluations, bench_fun_aot);
-				m_timeJIT += bench(evaluations, *m_function);
-				m_timeIRC += bench(evaluations, *m_interpreter_rec);
-				m_timeIST += bench(evaluations, *m_interpreter_stk);
-				m_timeIIR += bench(evaluations, *m_interpreter_ir);
-			};
-
-			m_timeAOT = m_timeIIR = m_timeIRC = m_timeIST = m_timeJIT = 0.0;
-
-			for (int r = 0; r < repetitions; ++r) apt();
-			double k = 1.0 / repetitions;
-			m_timeAOT *= k;
-			m_timeJIT *= k;
-			m_timeIRC *= k;
-			m_timeIST *= k;
-			m_timeIIR *= k;
-
-			m_hasResult = true;
-		}
-		ImGui::End();
-
-		if (m_hasResult) {
-			ImGui::Begin("Result");
-			ImGui::LabelText("AOT", flfrmt, m_timeAOT);
-			ImGui::LabelText("JIT", flfrmt, m_timeJIT);
-			ImGui::LabelText("Interpreter: recursive", flfrmt, m_timeIRC);
-			ImGui::LabelText("Interpreter: stack (tree)", flfrmt, m_timeIST);
-			ImGui::LabelText("Interpreter: stack (ir)", flfrmt, m_timeIIR);
-			ImGui::End();
-		}
-	}
+#include "benchmark_scene.h"
+#include <imgui/imgui.h>
+#include <cmath>
+#include <algorithm>
+#include <exprjit/x86_64.h>
+#include <exprjit/binary_encoder.h>
+#include <exprjit/function.h>
+#include <exprjit/parser.h>
+#include <exprjit/simplifier.h>
+#include <exprjit/jit.h>
+#include <exprjit/data_type.h>
+#include <exprjit/ir.h>
+#include <exprjit/ir_generator.h>
+#include <exprjit/ir_optimizer.h>
+#include <exprjit/ir_scheduler.h>
+#include <exprjit/ir_register_allocator.h>
+
+namespace ed
+{
+	double(* volatile bench_fun_aot )( double ) = [](double x) { return 18 - x * ( 3.14 - abs(x) + floor(x * abs(x - 5)) ); };
+	const char* bench_fun_src = "18 - x * (3.14 - abs x + floor (x * abs(x - 5)))";
+
+	void BenchmarkScene::initialize() {
+		{
+			std::vector<unsigned char> binary;
+			std::unordered_map<char, std::pair<unsigned, exprjit::DataType>> argmap {
+				{ 'x', { 0, exprjit::DataType::Float } }
+			};
+
+			evo::Timer timer;
+			size_t ei = exprjit::Parser(bench_fun_src, m_expression, argmap)( );
+			m_timeParse = timer.time<double>();
+			timer.reset();
+			ei = exprjit::Simplifier(m_expression, ei, exprjit::DataType::Float)();
+			exprjit::ir::Generator(m_expression, ei, m_instructions, exprjit::DataType::Float)();
+			exprjit::ir::Optimizer opt(m_instructions);
+			opt();
+			auto encoder = make_unique<exprjit::X86_64>(binary, 0, 1);
+			exprjit::ir::Scheduler(m_instructions, *encoder)();
+			// The interpreter runs the virtual register form, the allocated copy is compiled.
+			std::vector<exprjit::ir::Instruction> allocated = m_instructions;
+			exprjit::ir::RegisterAllocator(allocated, encoder->poolSize(exprjit::DataType::Integer), encoder->poolSize(exprjit::DataType::Float))();
+			exprjit::ir::jit(allocated, std::move(encoder));
+			m_function = std::make_unique<exprjit::Function<double(double)>>(binary);
+			m_timeJIT = timer.time<double>();
+
+			m_interpreter_rec = std::make_unique<RecursiveInterpreter>(m_expression, ei);
+			m_interpreter_stk = std::make_unique<StackInterpreter>(m_expression, ei);
+			m_interpreter_ir = std::make_unique<IRInterpreter>(m_instructions);
+		}
+	}
+
+	template<typename F>
+	double bench(int count, F&& f) {
+		double arg = rand() * 0.00147;
+		evo::Timer timer;
+		for (int i = 0; i < count; ++i) volatile double res = f(arg);
+		return timer.time<double>();
+	}
+
+	const char* trig_tier_names[] { "Fast", "Default", "Strict", "libm" };
+
+	void BenchmarkScene::benchmarkTrig(int evaluations) {
+		std::vector<double> args(evaluations);
+		for (double& a : args) a = ( rand() / (double)RAND_MAX * 2.0 - 1.0 ) * 100.0;
+
+		const auto measure = [&args](auto&& sin, auto&& cos, TrigResult& result) {
+			evo::Timer timer;
+			for (double a : args) volatile double res = sin(a);
+			result.timeSin = timer.time<double>();
+			timer.reset();
+			for (double a : args) volatile double res = cos(a);
+			result.timeCos = timer.time<double>();
+
+			result.errorSin = result.errorCos = 0.0;
+			for (double a : args) {
+				result.errorSin = std::max(result.errorSin, std::abs(sin(a) - std::sin(a)));
+				result.errorCos = std::max(result.errorCos, std::abs(cos(a) - std::cos(a)));
+			}
+		};
+
+		ExpressionCompiler compiler;
+		compiler.arg('x', 0, exprjit::DataType::Float);
+		for (int tier = 0; tier < 3; ++tier) {
+			compiler.setOptions({ (exprjit::TrigAccuracy)tier });
+			std::unique_ptr<exprjit::Function<double(double)>> sin(compiler.compile<double, double>("sin x"));
+			std::unique_ptr<exprjit::Function<double(double)>> cos(compiler.compile<double, double>("cos x"));
+			measure(*sin, *cos, m_trig[tier]);
+		}
+		measure([](double x) { return std::sin(x); }, [](double x) { return std::cos(x); }, m_trig[3]);
+		m_hasTrigResult = true;
+	}
+
+	// Sum of (x + k) * c terms, a chain of additions as written.
+	static std::string sum_chain_src(int terms) {
+		std::string src;
+		for (int t = 0; t < terms; ++t) {
+			if (t > 0) src += t % 4 == 3 ? " - " : " + ";
+			src += "(x + " + std::to_string(t + 1) + ".5) * 0." + std::to_string(t % 9 + 1);
+		}
+		return src;
+	}
+
+	void BenchmarkScene::benchmarkFastMath(int evaluations) {
+		const std::string src = sum_chain_src(32);
+		ExpressionCompiler compiler;
+		compiler.arg('x', 0, exprjit::DataType::Float);
+		compiler.setOptions({});
+		std::unique_ptr<exprjit::Function<double(double)>> strict(compiler.compile<double, double>(src));
+		exprjit::CompileOptions fast;
+		fast.fastMath = true;
+		compiler.setOptions(fast);
+		std::unique_ptr<exprjit::Function<double(double)>> reassociated(compiler.compile<double, double>(src));
+
+		// Each argument waits for the previous result, so the time is the latency of the chain.
+		const auto measure = [evaluations](auto& f) {
+			double arg = rand() * 0.00147, x = arg;
+			evo::Timer timer;
+			for (int i = 0; i < evaluations; ++i) x = f(x) * 0.0 + arg;
+			volatile double res = x;
+			return timer.time<double>();
+		};
+		m_fastMath.timeStrict = measure(*strict);
+		m_fastMath.timeFast = measure(*reassociated);
+
+		m_fastMath.error = 0.0;
+		for (int i = 0; i < evaluations; ++i) {
+			double x = ( rand() / (double)RAND_MAX * 2.0 - 1.0 ) * 100.0, exact = ( *strict )( x );
+			m_fastMath.error = std::max(m_fastMath.error, std::abs(( *reassociated )( x ) - exact) / std::max(std::abs(exact), 1.0));
+		}
+		m_hasFastMathResult = true;
+	}
+
+	const char* specialization_src = "sin y * x * x + cos y * x / y + floor(y * 2.5) * sin(y * 3)";
+	const char* mixed_specialization_src = "x * y + 1000000 - 1000000 + x / 3";
+
+	void BenchmarkScene::benchmarkSpecialization(int evaluations) {
+		constexpr double y = 0.5;
+		ExpressionCompiler compiler;
+		compiler.arg('x', 0, exprjit::DataType::Float);
+		compiler.arg('y', 1, exprjit::DataType::Float);
+		std::unique_ptr<exprjit::Function<double(double, double)>> generic(compiler.compile<double, double, double>(specialization_src));
+		std::unique_ptr<exprjit::Function<double(double)>> specialized(compiler.specialize<double, double>(specialization_src, { { 'y', y } }));
+
+		const auto bound = [&generic](double x) { return ( *generic )( x, y ); };
+		m_specialization.timeGeneric = bench(evaluations, bound);
+		m_specialization.timeSpecialized = bench(evaluations, *specialized);
+
+		m_specialization.error = 0.0;
+		for (int i = 0; i < evaluations; ++i) {
+			double x = ( rand() / (double)RAND_MAX * 2.0 - 1.0 ) * 100.0;
+			m_specialization.error = std::max(m_specialization.error, std::abs(( *specialized )( x ) - bound(x)));
+		}
+
+		// Single x, Float y: the generic kernel computes in double, so must the one for a bound y.
+		compiler.clearArgs();
+		compiler.arg('x', 0, exprjit::DataType::Single);
+		compiler.arg('y', 1, exprjit::DataType::Float);
+		std::unique_ptr<exprjit::Function<float(float, double)>> mixed(compiler.compile<float, float, double>(mixed_specialization_src));
+		std::unique_ptr<exprjit::Function<float(float)>> mixedSpecialized(compiler.specialize<float, float>(mixed_specialization_src, { { 'y', 0.1 } }));
+		m_specialization.mixedError = 0.0;
+		for (int i = 0; i < evaluations; ++i) {
+			float x = (float)( rand() / (double)RAND_MAX * 2.0 - 1.0 );
+			m_specialization.mixedError = std::max(m_specialization.mixedError, (double)std::abs(( *mixedSpecialized )( x ) - ( *mixed )( x, 0.1 )));
+		}
+		m_hasSpecializationResult = true;
+	}
+
+	// Straight-line IR made of the patterns the peephole rules rewrite, push/pop pairs included.
+	static std::vector<exprjit::ir::Instruction> synthetic_ir(size_t instructions) {
+		using namespace exprjit::ir;
+		std::vector<Instruction> ir;
+		size_t n = 0;
+		VirtualRegister acc = vreg(++n);
+		ir.push_back(Instruction(Code::IArgR, acc, (uint64_t)0));
+		while (ir.size() < instructions) {
+			VirtualRegister t = vreg(++n), k = vreg(++n), f = vreg(++n), r = vreg(++n);
+			ir.push_back(Instruction(Code::IPush, acc));
+			ir.push_back(Instruction(Code::IPop, t));
+			ir.push_back(Instruction(Code::ILoadR, k, (uint64_t)n));
+			ir.push_back(Instruction(Code::IAdd, t, k));
+			ir.push_back(Instruction(Code::IPush, t));
+			ir.push_back(Instruction(Code::IPop, t));
+			ir.push_back(Instruction(Code::IToF, f, t));
+			ir.push_back(Instruction(Code::FToI, r, f));
+			acc = r;
+		}
+		ir.push_back(Instruction(Code::IMov, VirtualRegister::IR, acc));
+		ir.push_back(Code::Ret);
+		return ir;
+	}
+
+	// The optimizer before the rule table, erasing push/pop pairs in place.
+	static void legacy_optimize(std::vector<exprjit::ir::Instruction>& ir) {
+		using exprjit::ir::Code;
+		size_t i = 0;
+		while (i < ir.size()) {
+			size_t ni = i + 1;
+			if (ni < ir.size() && ir[i].operands[0].reg == ir[ni].operands[0].reg && (
+				ir[i].code == Code::IPush && ir[ni].code == Code::IPop ||
+				ir[i].code == Code::FPush && ir[ni].code == Code::FPop
+			)) {
+				ir.erase(ir.begin() + i, ir.begin() + i + 2);
+				continue;
+			}
+			i = ni;
+		}
+	}
+
+	void BenchmarkScene::benchmarkOptimizer(size_t instructions) {
+		std::vector<exprjit::ir::Instruction> ir = synthetic_ir(instructions);
+		std::vector<exprjit::ir::Instruction> legacy = ir;
+		m_optimizer.sizeBefore = ir.size();
+
+		evo::Timer timer;
+		exprjit::ir::Optimizer opt(ir);
+		opt();
+		m_optimizer.time = timer.time<double>();
+		m_optimizer.sizeAfter = ir.size();
+
+		timer.reset();
+		legacy_optimize(legacy);
+		m_optimizer.timeLegacy = timer.time<double>();
+		m_hasOptimizerResult = true;
+	}
+
+	void BenchmarkScene::gui() {
+		constexpr const char* flfrmt = "%9.7f";
+		static int evaluations = 1000;
+		static int repetitions = 4;
+		static int optimizerInstructions = 100000;
+
+		ImGui::Begin("Expression JIT Demo Benchmark");
+		ImGui::Text(bench_fun_src);
+		ImGui::LabelText("Time parsing", flfrmt, m_timeParse);
+		ImGui::LabelText("Time compiling", flfrmt, m_timeComp);
+		ImGui::LabelText("Code memory", "%zu / %zu bytes", exprjit::FunctionAllocator::usedBytes(), exprjit::FunctionAllocator::reservedBytes());
+		ImGui::Separator();
+		ImGui::InputInt("Evaluations", &evaluations);
+		ImGui::InputInt("Repetitions", &repetitions);
+
+		if (ImGui::Button("Run")) {
+			const auto apt = [this]() {
+				m_timeAOT += bench(evaluations, bench_fun_aot);
+				m_timeJIT += bench(evaluations, *m_function);
+				m_timeIRC += bench(evaluations, *m_interpreter_rec);
+				m_timeIST += bench(evaluations, *m_interpreter_stk);
+				m_timeIIR += bench(evaluations, *m_interpreter_ir);
+			};
+
+			m_timeAOT = m_timeIIR = m_timeIRC = m_timeIST = m_timeJIT = 0.0;
+
+			for (int r = 0; r < repetitions; ++r) apt();
+			double k = 1.0 / repetitions;
+			m_timeAOT *= k;
+			m_timeJIT *= k;
+			m_timeIRC *= k;
+			m_timeIST *= k;
+			m_timeIIR *= k;
+
+			m_hasResult = true;
+		}
+		if (ImGui::Button("Run sin/cos tiers")) {
+			benchmarkTrig(evaluations);
+		}
+		if (ImGui::Button("Run fast math")) {
+			benchmarkFastMath(evaluations);
+		}
+		if (ImGui::Button("Run specialization")) {
+			benchmarkSpecialization(evaluations);
+		}
+		ImGui::InputInt("IR instructions", &optimizerInstructions);
+		if (ImGui::Button("Run optimizer")) {
+			benchmarkOptimizer((size_t)std::max(optimizerInstructions, 0));
+		}
+		ImGui::End();
+
+		if (m_hasResult) {
+			ImGui::Begin("Result");
+			ImGui::LabelText("AOT", flfrmt, m_timeAOT);
+			ImGui::LabelText("JIT", flfrmt, m_timeJIT);
+			ImGui::LabelText("Interpreter: recursive", flfrmt, m_timeIRC);
+			ImGui::LabelText("Interpreter: stack (tree)", flfrmt, m_timeIST);
+			ImGui::LabelText("Interpreter: stack (ir)", flfrmt, m_timeIIR);
+			ImGui::End();
+		}
+
+		if (m_hasTrigResult) {
+			ImGui::Begin("sin/cos tiers");
+			for (int tier = 0; tier < 4; ++tier) {
+				const TrigResult& r = m_trig[tier];
+				ImGui::LabelText(trig_tier_names[tier], "sin %9.7f (%.1e)  cos %9.7f (%.1e)", r.timeSin, r.errorSin, r.timeCos, r.errorCos);
+			}
+			ImGui::End();
+		}
+
+		if (m_hasFastMathResult) {
+			ImGui::Begin("Fast math (32 term sum)");
+			ImGui::LabelText("Strict", flfrmt, m_fastMath.timeStrict);
+			ImGui::LabelText("Fast math", flfrmt, m_fastMath.timeFast);
+			ImGui::LabelText("Max relative difference", "%.1e", m_fastMath.error);
+			ImGui::End();
+		}
+
+		if (m_hasSpecializationResult) {
+			ImGui::Begin("Specialization (y = 0.5)");
+			ImGui::Text(specialization_src);
+			ImGui::LabelText("f(x, y)", flfrmt, m_specialization.timeGeneric);
+			ImGui::LabelText("f(x, 0.5)", flfrmt, m_specialization.timeSpecialized);
+			ImGui::LabelText("Max difference", "%.1e", m_specialization.error);
+			ImGui::Text(mixed_specialization_src);
+			ImGui::LabelText("Max difference, Single x", "%.1e", m_specialization.mixedError);
+			ImGui::End();
+		}
+
+		if (m_hasOptimizerResult) {
+			ImGui::Begin("Peephole optimizer");
+			ImGui::LabelText("Instructions", "%zu -> %zu", m_optimizer.sizeBefore, m_optimizer.sizeAfter);
+			ImGui::LabelText("Rule table", flfrmt, m_optimizer.time);
+			ImGui::LabelText("Legacy (erase in place)", flfrmt, m_optimizer.timeLegacy);
+			ImGui::End();
+		}
+	}
 }
\ No newline at end of file
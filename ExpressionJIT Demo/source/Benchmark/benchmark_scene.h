@@ -1,33 +1,67 @@
-#pragma once
-#include <vector>
-#include <memory>
-#include <EvoNDZ/app/scene.h>
-#include <EvoNDZ/util/timer.h>
-#include <exprjit/expression_node.h>
-#include <exprjit/ir.h>
-#include "../expression_compiler.h"
-#include "../interpreter.h"
-
-namespace ed
-{
-	class BenchmarkScene final : public evo::Scene {
-	public:
-		void initialize() override;
-		void gui() override;
-
-		void update() override { }
-		void terminate() override { }
-		void render() override { }
-
-	private:
-		std::vector<exprjit::ExpressionNode> m_expression;
-		std::vector<exprjit::ir::Instruction> m_instructions;
-		std::unique_ptr<exprjit::Function<double(double)>> m_function;
-		std::unique_ptr<RecursiveInterpreter> m_interpreter_rec;
-		std::unique_ptr<StackInterpreter> m_interpreter_stk;
-		std::unique_ptr<IRInterpreter> m_interpreter_ir;
-		bool m_hasResult = false;
-		double m_timeAOT, m_timeJIT, m_timeIRC, m_timeIST, m_timeIIR;
-		double m_timeParse, m_timeComp;
-	};
+#pragma once
+#include <vector>
+#include <memory>
+#include <EvoNDZ/app/scene.h>
+#include <EvoNDZ/util/timer.h>
+#include <exprjit/expression_node.h>
+#include <exprjit/ir.h>
+#include "../expression_compiler.h"
+#include "../interpreter.h"
+
+namespace ed
+{
+	class BenchmarkScene final : public evo::Scene {
+	public:
+		void initialize() override;
+		void gui() override;
+
+		void update() override { }
+		void terminate() override { }
+		void render() override { }
+
+	private:
+		struct TrigResult {
+			double timeSin, timeCos;
+			double errorSin, errorCos; // max absolute error against libm
+		};
+
+		struct OptimizerResult {
+			size_t sizeBefore, sizeAfter;
+			double time, timeLegacy;
+		};
+
+		struct FastMathResult {
+			double timeStrict, timeFast; // evaluations depending on the previous result
+			double error; // max relative difference
+		};
+
+		struct SpecializationResult {
+			double timeGeneric, timeSpecialized;
+			double error; // max absolute difference
+			double mixedError; // of float(float x, double y), bound y must not change the precision
+		};
+
+		void benchmarkTrig(int evaluations);
+		void benchmarkFastMath(int evaluations);
+		void benchmarkSpecialization(int evaluations);
+		void benchmarkOptimizer(size_t instructions);
+
+		std::vector<exprjit::ExpressionNode> m_expression;
+		std::vector<exprjit::ir::Instruction> m_instructions;
+		std::unique_ptr<exprjit::Function<double(double)>> m_function;
+		std::unique_ptr<RecursiveInterpreter> m_interpreter_rec;
+		std::unique_ptr<StackInterpreter> m_interpreter_stk;
+		std::unique_ptr<IRInterpreter> m_interpreter_ir;
+		bool m_hasResult = false;
+		double m_timeAOT, m_timeJIT, m_timeIRC, m_timeIST, m_timeIIR;
+		double m_timeParse, m_timeComp;
+		TrigResult m_trig[4]; // accuracy tiers, then libm
+		bool m_hasTrigResult = false;
+		FastMathResult m_fastMath;
+		bool m_hasFastMathResult = false;
+		SpecializationResult m_specialization;
+		bool m_hasSpecializationResult = false;
+		OptimizerResult m_optimizer;
+		bool m_hasOptimizerResult = false;
+	};
 }
\ No newline at end of file
@@ -1,25 +1,69 @@
-#pragma once
-#include <memory>
-#include <NoisePollution/oscillator.h>
-#include <exprjit/function.h>
-#include "../expression_compiler.h"
-
-namespace ed
-{
-	class ExpressionOscillator : public np::Oscillator {
-	public:
-		ExpressionOscillator(std::unique_ptr<exprjit::Function<double(double)>>&& f, float frequency) 
-			: np::Oscillator(frequency), f(std::move(f)) { }
-
-		void setFunction(std::unique_ptr<exprjit::Function<double(double)>>&& f) noexcept {
-			this->f = std::move(f);
-		}
-
-	private:
-		float wave(float x) const override {
-			return (float)(*f)(x);
-		}
-
-		std::unique_ptr<exprjit::Function<double(double)>> f;
-	};
-}
\ No newline at end of file
+#pragma once
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <NoisePollution/oscillator.h>
+#include <exprjit/function.h>
+#include "../expression_compiler.h"
+
+namespace ed
+{
+	// Oscillator of f(x). The synthesizer pulls one sample at a time through wave, its phase x advancing by a
+	// fixed step between wraps. wave renders the samples ahead along that step with one call of the block kernel,
+	// a grid kernel of one row along x, and serves them while the pulled phases keep matching. Any other phase
+	// (the first sample, a wrap, a frequency change) starts a new block. Without a kernel f is called per sample.
+	class ExpressionOscillator : public np::Oscillator {
+	public:
+		constexpr static int64_t BlockSize = 256;
+		// Shorter runs, of high notes wrapping every few samples, cost more through the kernel than per sample.
+		constexpr static int64_t MinBlockSize = 16;
+
+		ExpressionOscillator(std::unique_ptr<exprjit::Function<float(float)>>&& f, float frequency,
+			std::unique_ptr<exprjit::GridFunction<float>>&& block)
+			: np::Oscillator(frequency), f(std::move(f)), block(std::move(block)) { }
+
+		void setFunction(std::unique_ptr<exprjit::Function<float(float)>>&& f, std::unique_ptr<exprjit::GridFunction<float>>&& block) noexcept {
+			this->f = std::move(f);
+			this->block = std::move(block);
+			count = 0;
+		}
+
+	private:
+		// Phases the synthesizer accumulates in float drift from start + i * step by a few ulps per sample.
+		constexpr static double PhaseTolerance = 1e-4;
+
+		float wave(float x) const override {
+			double previous = last;
+			last = x;
+			top = std::max(top, (double)x);
+			if (next < count && std::abs(x - ( start + next * step )) <= PhaseTolerance) return buffer[next++];
+
+			// Right after a wrap the step stays the one before.
+			double s = x > previous ? x - previous : step;
+			// Up to the highest phase seen, past it the synthesizer has wrapped so far.
+			int64_t n = BlockSize;
+			if (s > 0 && top > x) n = std::min((int64_t)( ( top - x ) / s ) + 1, BlockSize);
+			if (!block || !( s > 0 ) || n < MinBlockSize) {
+				count = 0;
+				step = s;
+				return (*f)(x);
+			}
+			( *block )( exprjit::Grid { x, s, 0, 0, n, 1 }, buffer );
+			start = x;
+			step = s;
+			count = n;
+			next = 1;
+			return buffer[0];
+		}
+
+		std::unique_ptr<exprjit::Function<float(float)>> f;
+		std::unique_ptr<exprjit::GridFunction<float>> block;
+
+		mutable float buffer[BlockSize];
+		mutable double start = 0, step = 0;
+		mutable int64_t next = 0, count = 0;
+		mutable double last = std::numeric_limits<double>::infinity();
+		mutable double top = -std::numeric_limits<double>::infinity();
+	};
+}
@@ -1,52 +1,204 @@
-#pragma once
-#include <unordered_map>
-#include <vector>
-#include <exprjit/x86_64.h>
-#include <exprjit/binary_encoder.h>
-#include <exprjit/function.h>
-#include <exprjit/parser.h>
-#include <exprjit/jit.h>
-#include <exprjit/data_type.h>
-#include <exprjit/ir.h>
-#include <exprjit/ir_generator.h>
-#include <exprjit/ir_optimizer.h>
-
-namespace ed
-{
-	class ExpressionCompiler {
-	public:
-		template<typename T> requires std::integral<T> || std::floating_point<T>
-		inline static constexpr exprjit::DataType ReturnDataType = 
-			std::integral<T> ? exprjit::DataType::Integer : exprjit::DataType::Float;
-
-		void clearArgs() {
-			argmap.clear();
-		}
-
-		void arg(char name, unsigned index, exprjit::DataType type) {
-			argmap.insert({ name, { index, type } });
-		}
-
-
-		template<typename ReturnType, typename... ArgumentTypes>
-		auto* compile(std::string_view src) {
-			expr.clear();
-			ir.clear();
-			binary.clear();
-
-			size_t ei = exprjit::Parser(src, expr, argmap)();
-			exprjit::ir::Generator(expr, ei, ir, ReturnDataType<ReturnType>)();
-			exprjit::ir::Optimizer opt(ir);
-			opt();
-			exprjit::ir::jit(ir, make_unique<exprjit::X86_64>(binary, 0, sizeof...(ArgumentTypes)));
-			return new exprjit::Function<ReturnType(ArgumentTypes...)>(binary);
-		}
-
-	private:
-		std::vector<exprjit::ExpressionNode> expr;
-		std::vector<exprjit::ir::Instruction> ir;
-		std::vector<unsigned char> binary;
-
-		std::unordered_map<char, std::pair<unsigned, exprjit::DataType>> argmap;
-	};
-}
\ No newline at end of file
+#pragma once
+#include <unordered_map>
+#include <list>
+#include <string>
+#include <vector>
+#include <memory>
+#include <bit>
+#include <filesystem>
+#include <exprjit/x86_64.h>
+#include <exprjit/binary_encoder.h>
+#include <exprjit/function.h>
+#include <exprjit/layout.h>
+#include <exprjit/parser.h>
+#include <exprjit/simplifier.h>
+#include <exprjit/jit.h>
+#include <exprjit/data_type.h>
+#include <exprjit/ir.h>
+#include <exprjit/ir_generator.h>
+#include <exprjit/ir_optimizer.h>
+#include <exprjit/ir_scheduler.h>
+#include <exprjit/ir_register_allocator.h>
+#include <exprjit/canonical_form.h>
+#include <exprjit/partial_evaluation.h>
+#include <exprjit/code_cache.h>
+#include <exprjit/compile_options.h>
+#include <exprjit/parameter_block.h>
+
+namespace ed
+{
+	class ExpressionCompiler {
+	public:
+		// Argument fixed by specialize, by name. Integer arguments take the value truncated, Single ones rounded.
+		struct Binding {
+			char name;
+			double value;
+		};
+
+		template<typename T> requires std::integral<T> || std::floating_point<T>
+		inline static constexpr exprjit::DataType ReturnDataType = 
+			std::integral<T> ? exprjit::DataType::Integer : std::same_as<T, float> ? exprjit::DataType::Single : exprjit::DataType::Float;
+
+		void clearArgs() {
+			argmap.clear();
+		}
+
+		void arg(char name, unsigned index, exprjit::DataType type) {
+			argmap.insert({ name, { index, type } });
+		}
+
+		void setOptions(const exprjit::CompileOptions& compileOptions) {
+			options = compileOptions;
+		}
+
+		// Block $name parameters are read from, new names are added to it. Functions compiled with it pass
+		// its address to the code, the block must outlive them.
+		void setParameters(exprjit::ParameterBlock* block) {
+			parameters = block;
+		}
+
+		// Compiled code is reused for expressions with the same canonical form and signature,
+		// at most cacheCapacity of the most recently used ones are kept alive by the cache.
+		void setCacheCapacity(size_t capacity) {
+			cacheCapacity = capacity;
+			trimCache();
+		}
+
+		void clearCache() {
+			cache.clear();
+			cacheOrder.clear();
+		}
+
+		// Also looks compiled code up in and stores it to the directory, so later runs skip compilation.
+		void setCacheDirectory(const std::filesystem::path& directory) {
+			diskCache = std::make_unique<exprjit::CodeCache>(directory, exprjit::X86_64::Version);
+		}
+
+		template<typename ReturnType, typename... ArgumentTypes>
+		auto* compile(std::string_view src) {
+			return new exprjit::Function<ReturnType(ArgumentTypes...)>(build<ReturnType, ArgumentTypes...>(src, {}, Kind::Scalar), parameters);
+		}
+
+		// Loop kernel evaluating the expression over whole arrays of arguments, see exprjit::BatchFunction.
+		// The layout reads arguments from and writes results to strided buffers or fields of records.
+		template<typename ReturnType, typename... ArgumentTypes>
+		auto* compileBatch(std::string_view src, const exprjit::BatchLayout& layout = {}) {
+			return new exprjit::BatchFunction<ReturnType(ArgumentTypes...)>(build<ReturnType, ArgumentTypes...>(src, {}, Kind::Batch, layout), parameters);
+		}
+
+		// Kernel evaluating the expression of the arguments x (index 0) and y (index 1) over a whole grid,
+		// writing the results into a caller's buffer laid out as given, see exprjit::GridFunction.
+		template<typename ReturnType>
+		auto* compileGrid(std::string_view src, const exprjit::Layout& layout) {
+			return new exprjit::GridFunction<ReturnType>(build<ReturnType>(src, {}, Kind::Grid, { {}, layout }), parameters);
+		}
+
+		// Code for the expression with some arguments fixed, taking the rest in their order. What depends on
+		// the bound arguments alone is computed here, so f(x, y) specialized for a y costs about what f(x) would.
+		template<typename ReturnType, typename... ArgumentTypes>
+		auto* specialize(std::string_view src, const std::vector<Binding>& bindings) {
+			std::vector<exprjit::ArgumentBinding> bound;
+			for (const Binding& b : bindings) {
+				auto [index, type] = argmap.at(b.name);
+				double value = type == exprjit::DataType::Single ? (double)(float)b.value : b.value;
+				bound.push_back({ index, type == exprjit::DataType::Integer ? (uint64_t)(int64_t)b.value : std::bit_cast<uint64_t>(value) });
+			}
+			return new exprjit::Function<ReturnType(ArgumentTypes...)>(build<ReturnType, ArgumentTypes...>(src, bound, Kind::Scalar), parameters);
+		}
+
+	private:
+		enum class Kind {
+			Scalar, Batch, Grid
+		};
+
+		struct CacheEntry {
+			exprjit::CodeHandle code;
+			std::list<std::string>::iterator order;
+		};
+
+		template<typename ReturnType, typename... ArgumentTypes>
+		exprjit::CodeHandle build(std::string_view src, const std::vector<exprjit::ArgumentBinding>& bindings, Kind kind, const exprjit::BatchLayout& layout = {}) {
+			expr.clear();
+			ir.clear();
+			binary.clear();
+
+			size_t ei = exprjit::Parser(src, expr, argmap, parameters)();
+			if (!bindings.empty()) exprjit::bindArguments(expr, bindings);
+			ei = exprjit::Simplifier(expr, ei, ReturnDataType<ReturnType>, options)();
+
+			std::string key = optionsKey() + signatureKey<ReturnType, ArgumentTypes...>();
+			if (kind == Kind::Batch) key += '*' + layoutKey(layout);
+			if (kind == Kind::Grid) key += '#' + layoutKey(layout);
+			key += exprjit::canonicalForm(expr, ei);
+			if (auto it = cache.find(key); it != cache.end()) {
+				cacheOrder.splice(cacheOrder.begin(), cacheOrder, it->second.order);
+				return it->second.code;
+			}
+
+			// code that is not relocatable is only valid in this process
+			bool persist = diskCache && options.relocatable();
+			exprjit::CodeHandle code = persist ? diskCache->load(key) : nullptr;
+			if (!code) {
+				std::vector<exprjit::DataType> signature { ReturnDataType<ArgumentTypes>... };
+				if (kind == Kind::Batch) signature.assign(3, exprjit::DataType::Integer); // args, out, n
+				if (kind == Kind::Grid) signature.assign(2, exprjit::DataType::Integer); // grid, out
+				if (exprjit::readsParameters(expr, ei)) signature.push_back(exprjit::DataType::Integer); // the block
+				auto encoder = make_unique<exprjit::X86_64>(binary, signature, options);
+				exprjit::ir::Generator generator(expr, ei, ir, ReturnDataType<ReturnType>, options);
+				if (kind == Kind::Batch) generator.batch(exprjit::ir::Generator::DefaultUnroll, encoder->lanes(), layout);
+				else if (kind == Kind::Grid) generator.grid(layout.result, exprjit::ir::Generator::DefaultUnroll, encoder->lanes());
+				else generator();
+				exprjit::ir::Optimizer opt(ir);
+				opt();
+				exprjit::ir::Scheduler(ir, *encoder)();
+				exprjit::ir::RegisterAllocator(ir, encoder->poolSize(exprjit::DataType::Integer), encoder->poolSize(exprjit::DataType::Float))();
+				exprjit::ir::jit(ir, std::move(encoder));
+				code = exprjit::FunctionAllocator::allocateShared(binary);
+				if (persist) diskCache->store(key, binary);
+			}
+
+			if (cacheCapacity > 0) {
+				cacheOrder.push_front(key);
+				cache.insert({ std::move(key), { code, cacheOrder.begin() } });
+				trimCache();
+			}
+			return code;
+		}
+
+		std::vector<exprjit::ExpressionNode> expr;
+		std::vector<exprjit::ir::Instruction> ir;
+		std::vector<unsigned char> binary;
+
+		std::unordered_map<char, std::pair<unsigned, exprjit::DataType>> argmap;
+		exprjit::CompileOptions options;
+		exprjit::ParameterBlock* parameters = nullptr;
+
+		std::unordered_map<std::string, CacheEntry> cache;
+		std::list<std::string> cacheOrder; // most recently used first
+		size_t cacheCapacity = 256;
+		std::unique_ptr<exprjit::CodeCache> diskCache;
+
+		std::string optionsKey() const {
+			return { (char)( 'a' + (int)options.trigAccuracy ), options.fastMath ? 'm' : 's' };
+		}
+
+		static std::string layoutKey(const exprjit::BatchLayout& layout) {
+			std::string key;
+			for (const exprjit::Layout& l : layout.arguments) key += std::to_string(l.stride) + ',' + std::to_string(l.offset) + ';';
+			return key + std::to_string(layout.result.stride) + ',' + std::to_string(layout.result.offset) + ';';
+		}
+
+		template<typename ReturnType, typename... ArgumentTypes>
+		static std::string signatureKey() {
+			constexpr auto code = [](exprjit::DataType type) { return "ifs"[(int)type - 1]; };
+			return { code(ReturnDataType<ReturnType>), '(', code(ReturnDataType<ArgumentTypes>)..., ')' };
+		}
+
+		void trimCache() {
+			while (cache.size() > cacheCapacity) {
+				cache.erase(cacheOrder.back());
+				cacheOrder.pop_back();
+			}
+		}
+	};
+}
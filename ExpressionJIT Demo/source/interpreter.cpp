@@ -1,190 +1,273 @@
-#include "interpreter.h"
-#include <bit>
-#include <cmath>
-
-namespace ed
-{
-	double RecursiveInterpreter::operator()(double arg) const noexcept {
-		return eval(m_root, arg);
-	}
-
-	double RecursiveInterpreter::eval(size_t i, double arg) const noexcept {
-		const auto& node = m_tree[i];
-
-		switch (node.type) {
-			case exprjit::ExpressionNode::Type::Argument:
-				return arg;
-			case exprjit::ExpressionNode::Type::Literal:
-				return std::bit_cast<double>(node.literal.value);
-			case exprjit::ExpressionNode::Type::Unop:
-			{
-				double oparg = eval(node.unop.operand, arg);
-				switch (node.unop.op) {
-					case exprjit::ExpressionNode::Unop::Negate:
-						return -oparg;
-					case exprjit::ExpressionNode::Unop::Abs:
-						return std::abs(oparg);
-					case exprjit::ExpressionNode::Unop::Sin:
-						return std::sin(oparg);
-					case exprjit::ExpressionNode::Unop::Cos:
-						return std::cos(oparg);
-					case exprjit::ExpressionNode::Unop::Floor:
-						return std::floor(oparg);
-				}
-				break;
-			}
-			case exprjit::ExpressionNode::Type::Binop:
-			{
-				double lhs = eval(node.binop.lhs, arg);
-				double rhs = eval(node.binop.rhs, arg);
-				switch (node.binop.op) {
-					case exprjit::ExpressionNode::Binop::Add:
-						return lhs + rhs;
-					case exprjit::ExpressionNode::Binop::Subtract:
-						return lhs - rhs;
-					case exprjit::ExpressionNode::Binop::Multiply:
-						return lhs * rhs;
-					case exprjit::ExpressionNode::Binop::Divide:
-						return lhs / rhs;
-					case exprjit::ExpressionNode::Binop::Modulo:
-						return std::fmod(lhs, rhs);
-				}
-				break;
-			}
-		}
-		return 0.;
-	}
-
-	double StackInterpreter::operator()(double arg) noexcept {
-		m_st.clear();
-		eval(m_root, arg);
-		return m_st.popf();
-	}
-
-	void StackInterpreter::eval(size_t i, double arg) noexcept {
-		const auto& node = m_tree[i];
-		
-		switch (node.type) {
-			case exprjit::ExpressionNode::Type::Argument:
-				m_st.push(arg);
-				break;
-			case exprjit::ExpressionNode::Type::Literal:
-				m_st.push(node.literal.value);
-				break;
-			case exprjit::ExpressionNode::Type::Unop:
-			{
-				eval(node.unop.operand, arg);
-				double oparg = m_st.popf();
-				switch (node.unop.op) {
-					case exprjit::ExpressionNode::Unop::Negate:
-						m_st.push(-oparg);
-						break;
-					case exprjit::ExpressionNode::Unop::Abs:
-						m_st.push(std::abs(oparg));
-						break;
-					case exprjit::ExpressionNode::Unop::Sin:
-						m_st.push(std::sin(oparg));
-						break;
-					case exprjit::ExpressionNode::Unop::Cos:
-						m_st.push(std::cos(oparg));
-						break;
-					case exprjit::ExpressionNode::Unop::Floor:
-						m_st.push(std::floor(oparg));
-						break;
-				}
-				break;
-			}
-			case exprjit::ExpressionNode::Type::Binop:
-			{
-				eval(node.binop.lhs, arg);
-				eval(node.binop.rhs, arg);
-				double rhs = m_st.popf();
-				double lhs = m_st.popf();
-				switch (node.binop.op) {
-					case exprjit::ExpressionNode::Binop::Add:
-						m_st.push(lhs + rhs);
-						break;
-					case exprjit::ExpressionNode::Binop::Subtract:
-						m_st.push(lhs - rhs);
-						break;
-					case exprjit::ExpressionNode::Binop::Multiply:
-						m_st.push(lhs * rhs);
-						break;
-					case exprjit::ExpressionNode::Binop::Divide:
-						m_st.push(lhs / rhs);
-						break;
-					case exprjit::ExpressionNode::Binop::Modulo:
-						m_st.push(std::fmod(lhs, rhs));
-						break;
-				}
-				break;
-			}
-		}
-	}
-
-	double IRInterpreter::operator()(double arg) noexcept {
-		m_st.clear();
-		using exprjit::ir::Code;
-
-		for (const auto i : m_instr) {
-			switch (i.code) {
-				case Code::ILoad:
-				case Code::FLoad:
-					m_st.push(i.operands->value);
-					break;
-				case Code::FArg:
-					m_st.push(arg);
-					break;
-				case Code::IToF:
-					m_st.push((double)m_st.popi());
-					break;
-				case Code::FToI:
-					m_st.push((int64_t)m_st.popf());
-					break;
-				case Code::FAdd:
-					m_st.push(m_st.popf() + m_st.popf());
-					break;
-				case Code::FSub:
-					m_st.push(m_st.popf() - m_st.popf());
-					break;
-				case Code::FMul:
-					m_st.push(m_st.popf() * m_st.popf());
-					break;
-				case Code::FDiv:
-					m_st.push(m_st.popf() / m_st.popf());
-					break;
-				case Code::FAbs:
-					m_st.push(abs(m_st.popf()));
-					break;
-				case Code::FSin:
-					m_st.push(sin(m_st.popf()));
-					break;
-				case Code::FFloor:
-					m_st.push(floor(m_st.popf()));
-					break;
-				case Code::FCos:
-					m_st.push(cos(m_st.popf()));
-					break;
-				case Code::IAdd:
-					m_st.push(m_st.popi() + m_st.popi());
-					break;
-				case Code::ISub:
-					m_st.push(m_st.popi() - m_st.popi());
-					break;
-				case Code::IMul:
-					m_st.push(m_st.popi() * m_st.popi());
-					break;
-				case Code::IDiv:
-					m_st.push(m_st.popi() / m_st.popi());
-					break;
-				case Code::IAbs:
-					m_st.push(abs(m_st.popi()));
-					break;
-				case Code::Ret:
-					return m_st.popf();
-			}
-		}
-
-		terminate();
-	}
+#include "interpreter.h"
+#include <exprjit/parameter_block.h>
+#include <bit>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+namespace ed
+{
+	double RecursiveInterpreter::operator()(double arg) const noexcept {
+		return eval(m_root, arg);
+	}
+
+	double RecursiveInterpreter::eval(size_t i, double arg) const noexcept {
+		const auto& node = m_tree[i];
+
+		switch (node.type) {
+			case exprjit::ExpressionNode::Type::Argument:
+				return arg;
+			case exprjit::ExpressionNode::Type::Literal:
+				return std::bit_cast<double>(node.literal.value);
+			case exprjit::ExpressionNode::Type::Unop:
+			{
+				double oparg = eval(node.unop.operand, arg);
+				switch (node.unop.op) {
+					case exprjit::ExpressionNode::Unop::Negate:
+						return -oparg;
+					case exprjit::ExpressionNode::Unop::Abs:
+						return std::abs(oparg);
+					case exprjit::ExpressionNode::Unop::Sin:
+						return std::sin(oparg);
+					case exprjit::ExpressionNode::Unop::Cos:
+						return std::cos(oparg);
+					case exprjit::ExpressionNode::Unop::Floor:
+						return std::floor(oparg);
+				}
+				break;
+			}
+			case exprjit::ExpressionNode::Type::Binop:
+			{
+				double lhs = eval(node.binop.lhs, arg);
+				double rhs = eval(node.binop.rhs, arg);
+				switch (node.binop.op) {
+					case exprjit::ExpressionNode::Binop::Add:
+						return lhs + rhs;
+					case exprjit::ExpressionNode::Binop::Subtract:
+						return lhs - rhs;
+					case exprjit::ExpressionNode::Binop::Multiply:
+						return lhs * rhs;
+					case exprjit::ExpressionNode::Binop::Divide:
+						return lhs / rhs;
+					case exprjit::ExpressionNode::Binop::Modulo:
+						return std::fmod(lhs, rhs);
+				}
+				break;
+			}
+		}
+		return 0.;
+	}
+
+	double StackInterpreter::operator()(double arg) noexcept {
+		m_st.clear();
+		eval(m_root, arg);
+		return m_st.popf();
+	}
+
+	void StackInterpreter::eval(size_t i, double arg) noexcept {
+		const auto& node = m_tree[i];
+		
+		switch (node.type) {
+			case exprjit::ExpressionNode::Type::Argument:
+				m_st.push(arg);
+				break;
+			case exprjit::ExpressionNode::Type::Literal:
+				m_st.push(node.literal.value);
+				break;
+			case exprjit::ExpressionNode::Type::Unop:
+			{
+				eval(node.unop.operand, arg);
+				double oparg = m_st.popf();
+				switch (node.unop.op) {
+					case exprjit::ExpressionNode::Unop::Negate:
+						m_st.push(-oparg);
+						break;
+					case exprjit::ExpressionNode::Unop::Abs:
+						m_st.push(std::abs(oparg));
+						break;
+					case exprjit::ExpressionNode::Unop::Sin:
+						m_st.push(std::sin(oparg));
+						break;
+					case exprjit::ExpressionNode::Unop::Cos:
+						m_st.push(std::cos(oparg));
+						break;
+					case exprjit::ExpressionNode::Unop::Floor:
+						m_st.push(std::floor(oparg));
+						break;
+				}
+				break;
+			}
+			case exprjit::ExpressionNode::Type::Binop:
+			{
+				eval(node.binop.lhs, arg);
+				eval(node.binop.rhs, arg);
+				double rhs = m_st.popf();
+				double lhs = m_st.popf();
+				switch (node.binop.op) {
+					case exprjit::ExpressionNode::Binop::Add:
+						m_st.push(lhs + rhs);
+						break;
+					case exprjit::ExpressionNode::Binop::Subtract:
+						m_st.push(lhs - rhs);
+						break;
+					case exprjit::ExpressionNode::Binop::Multiply:
+						m_st.push(lhs * rhs);
+						break;
+					case exprjit::ExpressionNode::Binop::Divide:
+						m_st.push(lhs / rhs);
+						break;
+					case exprjit::ExpressionNode::Binop::Modulo:
+						m_st.push(std::fmod(lhs, rhs));
+						break;
+				}
+				break;
+			}
+		}
+	}
+
+	IRInterpreter::IRInterpreter(const std::vector<exprjit::ir::Instruction>& instr, const exprjit::ParameterBlock* parameters)
+		: m_instr(instr), m_parameters(parameters ? parameters->data() : nullptr) {
+		size_t count = FixedRegisters;
+		for (const auto& i : instr) {
+			auto info = exprjit::ir::operandInfo(i.code);
+			for (size_t o = 0; o < 2; ++o) {
+				const auto& op = i.operands[o];
+				if (info[o].access == exprjit::ir::Access::None || op.immediate || !exprjit::ir::isVirtual(op.reg)) continue;
+				count = std::max(count, FixedRegisters + exprjit::ir::vregIndex(op.reg) + 1);
+			}
+		}
+		m_registers.resize(count);
+	}
+
+	double IRInterpreter::operator()(double arg) noexcept {
+		using exprjit::ir::Code;
+
+		for (const auto& in : m_instr) {
+			const auto& a = in.operands[0];
+			const auto& b = in.operands[1];
+			switch (in.code) {
+				case Code::ILoadR:
+				case Code::FLoadR:
+					set(a, b.value);
+					break;
+				case Code::IArgR:
+					set(a, (int64_t)arg);
+					break;
+				case Code::FArgR:
+					set(a, arg);
+					break;
+				case Code::IBlockR:
+					set(a, m_parameters);
+					break;
+				case Code::FParamR:
+					set(a, reinterpret_cast<const exprjit::ParameterBlock::Value*>(i(b))[in.operands[2].value].load(std::memory_order_relaxed));
+					break;
+				case Code::IMov:
+				case Code::FMov:
+					reg(a.reg) = reg(b.reg);
+					break;
+				case Code::IToF:
+					set(a, (double)i(b));
+					break;
+				case Code::FToI:
+					set(a, (int64_t)f(b));
+					break;
+				case Code::FAdd:
+					set(a, f(a) + f(b));
+					break;
+				case Code::FSub:
+					set(a, f(a) - f(b));
+					break;
+				case Code::FMul:
+					set(a, f(a) * f(b));
+					break;
+				case Code::FDiv:
+					set(a, f(a) / f(b));
+					break;
+				case Code::FMod:
+					set(a, fmod(f(a), f(b)));
+					break;
+				case Code::FAddK:
+					set(a, f(a) + std::bit_cast<double>(b.value));
+					break;
+				case Code::FMulK:
+					set(a, f(a) * std::bit_cast<double>(b.value));
+					break;
+				case Code::FDivK:
+					set(a, f(a) / std::bit_cast<double>(b.value));
+					break;
+				case Code::FMulAddK:
+					set(a, std::fma(f(a), f(b), std::bit_cast<double>(in.operands[2].value)));
+					break;
+				case Code::FMulKAdd:
+					set(a, std::fma(f(b), std::bit_cast<double>(in.operands[2].value), f(a)));
+					break;
+				case Code::FNeg:
+					set(a, -f(a));
+					break;
+				case Code::FAbs:
+					set(a, std::abs(f(a)));
+					break;
+				case Code::FSin:
+					set(a, sin(f(a)));
+					break;
+				case Code::FFloor:
+					set(a, floor(f(a)));
+					break;
+				case Code::FCeil:
+					set(a, ceil(f(a)));
+					break;
+				case Code::FCos:
+					set(a, cos(f(a)));
+					break;
+				case Code::FSinCos:
+					set(b, cos(f(a)));
+					set(a, sin(f(a)));
+					break;
+				case Code::IAdd:
+					set(a, i(a) + i(b));
+					break;
+				case Code::ISub:
+					set(a, i(a) - i(b));
+					break;
+				case Code::IMul:
+					set(a, i(a) * i(b));
+					break;
+				case Code::IDiv:
+					set(a, i(a) / i(b));
+					break;
+				case Code::IMod:
+					set(a, i(a) % i(b));
+					break;
+				case Code::IAddI:
+					set(a, i(a) + (int64_t)b.value);
+					break;
+				case Code::ISubI:
+					set(a, i(a) - (int64_t)b.value);
+					break;
+				case Code::IMulI:
+					set(a, i(a) * (int64_t)b.value);
+					break;
+				case Code::IDivI:
+					set(a, i(a) / (int64_t)b.value);
+					break;
+				case Code::IModI:
+					set(a, i(a) % (int64_t)b.value);
+					break;
+				case Code::ILea:
+					set(a, (int64_t)( (uint64_t)i(a) + (uint64_t)i(b) * ( in.operands[2].value & 0xFF ) + (uint64_t)(int64_t)(int32_t)( in.operands[2].value >> 32 ) ));
+					break;
+				case Code::INeg:
+					set(a, -i(a));
+					break;
+				case Code::IAbs:
+					set(a, std::abs(i(a)));
+					break;
+				case Code::Ret:
+					return std::bit_cast<double>(reg(exprjit::ir::VirtualRegister::FR));
+			}
+		}
+
+		std::terminate();
+	}
 }
\ No newline at end of file
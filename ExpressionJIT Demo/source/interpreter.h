@@ -1,69 +1,81 @@
-#pragma once
-#include <vector>
-#include <bit>
-#include <exprjit/expression_node.h>
-#include <exprjit/ir.h>
-
-namespace ed
-{	
-	class InterpreterStack {
-	public:
-		InterpreterStack(size_t capacity) : m_size(0), m_data(new uint64_t[capacity]) { }
-		~InterpreterStack() { delete[] m_data; }
-
-		template<typename T> void push(T value) noexcept { m_data[m_size++] = std::bit_cast<uint64_t>( value ); }
-		double popf() noexcept { return std::bit_cast<double>(m_data[--m_size]); }
-		int64_t popi() noexcept { return std::bit_cast<int64_t>(m_data[--m_size]); }
-		void clear() { m_size = 0; }
-
-	private:
-		uint64_t* m_data;
-		size_t m_size;
-	};
-
-	class ExpressionTreeInterpreter {
-	public:
-		ExpressionTreeInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root) 
-			: m_root(root), m_tree(exprtree) { }
-
-
-	protected:
-		const std::vector<exprjit::ExpressionNode>& m_tree;
-		size_t m_root;
-	};
-
-	class RecursiveInterpreter final : public ExpressionTreeInterpreter {
-	public:
-		RecursiveInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root)
-			: ExpressionTreeInterpreter(exprtree, root) { }
-
-		double operator()(double) const noexcept;
-
-	private:
-		double eval(size_t i, double arg) const noexcept;
-	};
-
-	class StackInterpreter final : public ExpressionTreeInterpreter {
-	public:
-		StackInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root)
-			: ExpressionTreeInterpreter(exprtree, root), m_st(256) { }
-
-		double operator()(double) noexcept;
-
-	private:
-		InterpreterStack m_st;
-
-		void eval(size_t i, double arg) noexcept;
-	};
-
-	class IRInterpreter final {
-	public:
-		IRInterpreter(const std::vector<exprjit::ir::Instruction>& instr) : m_instr(instr), m_st(256) { }
-
-		double operator()(double) noexcept;
-
-	private:
-		InterpreterStack m_st;
-		const std::vector<exprjit::ir::Instruction>& m_instr;
-	};
+#pragma once
+#include <vector>
+#include <bit>
+#include <exprjit/expression_node.h>
+#include <exprjit/ir.h>
+#include <exprjit/parameter_block.h>
+
+namespace ed
+{	
+	class InterpreterStack {
+	public:
+		InterpreterStack(size_t capacity) : m_size(0), m_data(new uint64_t[capacity]) { }
+		~InterpreterStack() { delete[] m_data; }
+
+		template<typename T> void push(T value) noexcept { m_data[m_size++] = std::bit_cast<uint64_t>( value ); }
+		double popf() noexcept { return std::bit_cast<double>(m_data[--m_size]); }
+		int64_t popi() noexcept { return std::bit_cast<int64_t>(m_data[--m_size]); }
+		void clear() { m_size = 0; }
+
+	private:
+		uint64_t* m_data;
+		size_t m_size;
+	};
+
+	class ExpressionTreeInterpreter {
+	public:
+		ExpressionTreeInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root) 
+			: m_root(root), m_tree(exprtree) { }
+
+
+	protected:
+		const std::vector<exprjit::ExpressionNode>& m_tree;
+		size_t m_root;
+	};
+
+	class RecursiveInterpreter final : public ExpressionTreeInterpreter {
+	public:
+		RecursiveInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root)
+			: ExpressionTreeInterpreter(exprtree, root) { }
+
+		double operator()(double) const noexcept;
+
+	private:
+		double eval(size_t i, double arg) const noexcept;
+	};
+
+	class StackInterpreter final : public ExpressionTreeInterpreter {
+	public:
+		StackInterpreter(const std::vector<exprjit::ExpressionNode>& exprtree, size_t root)
+			: ExpressionTreeInterpreter(exprtree, root), m_st(256) { }
+
+		double operator()(double) noexcept;
+
+	private:
+		InterpreterStack m_st;
+
+		void eval(size_t i, double arg) noexcept;
+	};
+
+	// Runs Generator's output directly, virtual registers live in a register file.
+	class IRInterpreter final {
+	public:
+		IRInterpreter(const std::vector<exprjit::ir::Instruction>& instr, const exprjit::ParameterBlock* parameters = nullptr);
+
+		double operator()(double) noexcept;
+
+	private:
+		constexpr static size_t FixedRegisters = 16;
+
+		std::vector<uint64_t> m_registers;
+		const std::vector<exprjit::ir::Instruction>& m_instr;
+		const exprjit::ParameterBlock::Value* m_parameters;
+
+		uint64_t& reg(exprjit::ir::VirtualRegister vr) noexcept {
+			return m_registers[exprjit::ir::isVirtual(vr) ? FixedRegisters + exprjit::ir::vregIndex(vr) : (size_t)vr];
+		}
+		double f(const exprjit::ir::Operand& op) noexcept { return std::bit_cast<double>(reg(op.reg)); }
+		int64_t i(const exprjit::ir::Operand& op) noexcept { return std::bit_cast<int64_t>(reg(op.reg)); }
+		template<typename T> void set(const exprjit::ir::Operand& op, T value) noexcept { reg(op.reg) = std::bit_cast<uint64_t>(value); }
+	};
 }
\ No newline at end of file
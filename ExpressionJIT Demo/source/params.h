@@ -1,8 +1,8 @@
-#pragma once
-
-namespace ed
-{
-	inline constexpr const char* FloatInputFormat = "%6.3f";
-	inline constexpr unsigned WindowWidth = 1400;
-	inline constexpr unsigned WindowHeight = 800;
+#pragma once
+
+namespace ed
+{
+	inline constexpr const char* FloatInputFormat = "%6.3f";
+	inline constexpr unsigned WindowWidth = 1400;
+	inline constexpr unsigned WindowHeight = 800;
 }
\ No newline at end of file
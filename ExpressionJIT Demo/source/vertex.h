@@ -1,10 +1,10 @@
-#pragma once
-#include <EvoNDZ/math/vector3.h>
-
-namespace ed
-{
-	struct Vertex {
-		evo::Vector3f p;
-		evo::Vector3f n;
-	};
+#pragma once
+#include <EvoNDZ/math/vector3.h>
+
+namespace ed
+{
+	struct Vertex {
+		evo::Vector3f p;
+		evo::Vector3f n;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "include/exprjit/canonical_form.h"
+#include <unordered_map>
+
+namespace exprjit
+{
+	static uint64_t mix(uint64_t h, uint64_t v) noexcept {
+		h ^= v + 0x9E3779B97F4A7C15ull + ( h << 6 ) + ( h >> 2 );
+		return h * 0xFF51AFD7ED558CCDull;
+	}
+
+	static bool commutative(ExpressionNode::Binop op) noexcept {
+		return op == ExpressionNode::Binop::Add || op == ExpressionNode::Binop::Multiply;
+	}
+
+	class CanonicalFormBuilder {
+	public:
+		CanonicalFormBuilder(const std::vector<ExpressionNode>& expr) : m_expr(expr) { }
+
+		std::string operator()(size_t root) {
+			hash(root);
+			write(root);
+			return std::move(m_out);
+		}
+
+	private:
+		const std::vector<ExpressionNode>& m_expr;
+		std::unordered_map<size_t, uint64_t> m_hashes;
+		std::string m_out;
+
+		// Structural hash, only used to pick a stable operand order for commutative nodes.
+		uint64_t hash(size_t i) {
+			auto it = m_hashes.find(i);
+			if (it != m_hashes.end()) return it->second;
+
+			const auto& node = m_expr[i];
+			uint64_t h = mix(0, (uint64_t)node.type);
+			switch (node.type) {
+				case ExpressionNode::Type::Binop:
+				{
+					uint64_t l = hash(node.binop.lhs), r = hash(node.binop.rhs);
+					if (commutative(node.binop.op) && r < l) std::swap(l, r);
+					h = mix(mix(mix(h, (uint64_t)node.binop.op), l), r);
+					break;
+				}
+				case ExpressionNode::Type::Unop:
+					h = mix(mix(h, (uint64_t)node.unop.op), hash(node.unop.operand));
+					break;
+				case ExpressionNode::Type::Literal:
+					h = mix(mix(h, (uint64_t)node.literal.type | (uint64_t)node.literal.typed << 8), node.literal.value);
+					break;
+				case ExpressionNode::Type::Argument:
+					h = mix(mix(h, (uint64_t)node.argument.type), node.argument.index);
+					break;
+				case ExpressionNode::Type::Parameter:
+					h = mix(h, node.parameter.index);
+					break;
+			}
+			m_hashes.insert({ i, h });
+			return h;
+		}
+
+		void number(uint64_t v) {
+			constexpr const char* digits = "0123456789abcdef";
+			char buffer[16];
+			int n = 0;
+			do {
+				buffer[n++] = digits[v & 0xF];
+				v >>= 4;
+			} while (v != 0);
+			while (n > 0) m_out.push_back(buffer[--n]);
+		}
+
+		void write(size_t i) {
+			const auto& node = m_expr[i];
+			switch (node.type) {
+				case ExpressionNode::Type::Binop:
+				{
+					size_t lhs = node.binop.lhs, rhs = node.binop.rhs;
+					if (commutative(node.binop.op) && m_hashes.at(rhs) < m_hashes.at(lhs)) std::swap(lhs, rhs);
+					m_out.append("(b");
+					number((uint64_t)node.binop.op);
+					m_out.push_back(' ');
+					write(lhs);
+					m_out.push_back(' ');
+					write(rhs);
+					m_out.push_back(')');
+					break;
+				}
+				case ExpressionNode::Type::Unop:
+					m_out.append("(u");
+					number((uint64_t)node.unop.op);
+					m_out.push_back(' ');
+					write(node.unop.operand);
+					m_out.push_back(')');
+					break;
+				case ExpressionNode::Type::Literal:
+					if (node.literal.typed) m_out.push_back('=');
+					m_out.push_back(node.literal.type == DataType::Integer ? 'i' : node.literal.type == DataType::Single ? 's' : 'f');
+					number(node.literal.value);
+					break;
+				case ExpressionNode::Type::Argument:
+					m_out.push_back(node.argument.type == DataType::Integer ? 'I' : node.argument.type == DataType::Single ? 'S' : 'F');
+					number(node.argument.index);
+					break;
+				case ExpressionNode::Type::Parameter:
+					m_out.push_back('$');
+					number(node.parameter.index);
+					break;
+			}
+		}
+	};
+
+	std::string canonicalForm(const std::vector<ExpressionNode>& expr, size_t root) {
+		return CanonicalFormBuilder(expr)(root);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "include/exprjit/code_arena.h"
+#include "include/exprjit/function_allocator.h"
+#include <algorithm>
+#include <cassert>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace exprjit
+{
+	constexpr unsigned char TrapByte = 0xCC; // int3, freed blocks trap instead of running stale code
+
+	static size_t alignUp(size_t value, size_t alignment) noexcept {
+		return ( value + alignment - 1 ) / alignment * alignment;
+	}
+
+	CodeArena& CodeArena::instance() noexcept {
+		// Never destroyed: functions owned by other static objects may outlive it otherwise.
+		static CodeArena* arena = new CodeArena();
+		return *arena;
+	}
+
+	size_t CodeArena::mapRegion(size_t size) {
+#ifdef _WIN32
+		HANDLE mapping = CreateFileMappingW(
+			INVALID_HANDLE_VALUE, nullptr, PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+			(DWORD)( (uint64_t)size >> 32 ), (DWORD)size, nullptr
+		);
+		if (mapping == nullptr) {
+			throw VirtualAllocException(GetLastError());
+		}
+		void* writable = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+		if (writable == nullptr) {
+			DWORD error = GetLastError();
+			CloseHandle(mapping);
+			throw VirtualAllocException(error);
+		}
+		void* executable = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, size);
+		if (executable == nullptr) {
+			DWORD error = GetLastError();
+			UnmapViewOfFile(writable);
+			CloseHandle(mapping);
+			throw VirtualProtectException(error);
+		}
+#else
+#ifdef __linux__
+		int fd = memfd_create("exprjit", MFD_CLOEXEC);
+#else
+		char name[64];
+		std::snprintf(name, sizeof(name), "/exprjit.%ld.%zu", (long)getpid(), m_regions.size());
+		int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) shm_unlink(name);
+#endif
+		if (fd < 0) {
+			throw VirtualAllocException(errno);
+		}
+		if (ftruncate(fd, (off_t)size) != 0) {
+			int error = errno;
+			close(fd);
+			throw VirtualAllocException(error);
+		}
+		void* writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (writable == MAP_FAILED) {
+			int error = errno;
+			close(fd);
+			throw VirtualAllocException(error);
+		}
+		void* executable = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+		if (executable == MAP_FAILED) {
+			int error = errno;
+			munmap(writable, size);
+			close(fd);
+			throw VirtualProtectException(error);
+		}
+		close(fd); // the mappings keep the memory alive
+		void* mapping = nullptr;
+#endif
+
+		m_regions.push_back({ (unsigned char*)writable, (unsigned char*)executable, size, 0, mapping });
+		m_reserved += size;
+		return m_regions.size() - 1;
+	}
+
+	unsigned char* CodeArena::writable(unsigned char* executable, size_t region) const noexcept {
+		const Region& r = m_regions[region];
+		return r.writable + ( executable - r.executable );
+	}
+
+	unsigned char* CodeArena::take(size_t size, size_t& region) {
+		// Reuse the smallest freed block that fits without wasting more than half of it.
+		auto fit = m_free.lower_bound(size);
+		if (fit != m_free.end() && fit->first <= size * 2) {
+			unsigned char* block = fit->second.back();
+			fit->second.pop_back();
+			if (fit->second.empty()) m_free.erase(fit);
+			Block& reused = m_blocks.at(block);
+			reused.live = true;
+			region = reused.region;
+			return block;
+		}
+
+		if (m_regions.empty() || m_regions.back().size - m_regions.back().top < size) {
+			region = mapRegion(std::max(RegionSize, alignUp(size, RegionSize)));
+		}
+		else {
+			region = m_regions.size() - 1;
+		}
+		Region& r = m_regions[region];
+		unsigned char* block = r.executable + r.top;
+		r.top += size;
+		m_blocks.insert({ block, { size, region, true } });
+		return block;
+	}
+
+	void* CodeArena::allocate(std::span<const unsigned char> code) {
+		size_t size = alignUp(std::max<size_t>(code.size(), 1), BlockAlignment);
+
+		std::lock_guard lock(m_mutex);
+		size_t region;
+		unsigned char* block = take(size, region);
+		size = m_blocks.at(block).size;
+
+		unsigned char* dst = writable(block, region);
+		std::copy(code.begin(), code.end(), dst);
+		std::fill(dst + code.size(), dst + size, TrapByte);
+#ifdef _WIN32
+		FlushInstructionCache(GetCurrentProcess(), block, size);
+#else
+		__builtin___clear_cache((char*)block, (char*)block + size);
+#endif
+
+		m_used += size;
+		return block;
+	}
+
+	bool CodeArena::free(void* ptr) noexcept {
+		if (ptr == nullptr) return false;
+
+		std::lock_guard lock(m_mutex);
+		auto it = m_blocks.find(ptr);
+		// Pushing a block on a free list twice would hand it out to two functions.
+		assert(it != m_blocks.end() && it->second.live && "Freeing a block the arena did not allocate or already freed.");
+		if (it == m_blocks.end() || !it->second.live) return false;
+		it->second.live = false;
+
+		unsigned char* block = (unsigned char*)ptr;
+		std::fill_n(writable(block, it->second.region), it->second.size, TrapByte);
+		m_used -= it->second.size;
+		try {
+			m_free[it->second.size].push_back(block);
+		}
+		catch (...) {
+			return false; // block leaks, but stays trapped
+		}
+		return true;
+	}
+
+	size_t CodeArena::used() const noexcept {
+		std::lock_guard lock(m_mutex);
+		return m_used;
+	}
+
+	size_t CodeArena::reserved() const noexcept {
+		std::lock_guard lock(m_mutex);
+		return m_reserved;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "include/exprjit/code_cache.h"
+#include "include/exprjit/cpu_features.h"
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace exprjit
+{
+	namespace
+	{
+		// Read-only executable view of a whole file.
+		struct MappedFile {
+			unsigned char* data = nullptr;
+			size_t size = 0;
+
+			static MappedFile map(const std::filesystem::path& path) noexcept {
+				MappedFile file;
+#ifdef _WIN32
+				HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_EXECUTE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (handle == INVALID_HANDLE_VALUE) return file;
+				LARGE_INTEGER size;
+				if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+					HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_EXECUTE_READ, 0, 0, nullptr);
+					if (mapping != nullptr) {
+						file.data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, 0);
+						if (file.data != nullptr) file.size = (size_t)size.QuadPart;
+						CloseHandle(mapping);
+					}
+				}
+				CloseHandle(handle);
+#else
+				int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0) return file;
+				struct stat st;
+				if (fstat(fd, &st) == 0 && st.st_size > 0) {
+					void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+					if (data != MAP_FAILED) {
+						file.data = (unsigned char*)data;
+						file.size = (size_t)st.st_size;
+					}
+				}
+				close(fd);
+#endif
+				return file;
+			}
+
+			static void unmap(unsigned char* data, size_t size) noexcept {
+#ifdef _WIN32
+				UnmapViewOfFile(data);
+#else
+				munmap(data, size);
+#endif
+			}
+		};
+	}
+
+	// Unique to the process, thread and call, so concurrent stores of one key never write the same file.
+	static std::string temporarySuffix() {
+		static std::atomic<uint64_t> counter { 0 };
+#ifdef _WIN32
+		unsigned long long process = GetCurrentProcessId();
+#else
+		unsigned long long process = (unsigned long long)getpid();
+#endif
+		char suffix[80];
+		std::snprintf(suffix, sizeof(suffix), ".%llx.%zx.%llx.tmp", process, std::hash<std::thread::id>()(std::this_thread::get_id()),
+			(unsigned long long)counter.fetch_add(1, std::memory_order_relaxed));
+		return suffix;
+	}
+
+	CodeCache::CodeCache(std::filesystem::path directory, uint32_t encoderVersion)
+		: m_directory(std::move(directory)), m_encoderVersion(encoderVersion), m_cpuFeatures(CpuFeatures::host().bits()) {
+		std::error_code ec;
+		std::filesystem::create_directories(m_directory, ec);
+	}
+
+	uint64_t CodeCache::hash(std::string_view key) noexcept {
+		uint64_t h = 0xCBF29CE484222325ull; // FNV-1a
+		for (char c : key) {
+			h ^= (unsigned char)c;
+			h *= 0x100000001B3ull;
+		}
+		return h;
+	}
+
+	std::filesystem::path CodeCache::entryPath(uint64_t keyHash) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.ejit", (unsigned long long)keyHash);
+		return m_directory / name;
+	}
+
+	CodeHandle CodeCache::load(std::string_view key) const {
+		uint64_t keyHash = hash(key);
+		auto path = entryPath(keyHash);
+		MappedFile file = MappedFile::map(path);
+		if (file.data == nullptr) return nullptr;
+
+		Header header;
+		bool valid = file.size >= sizeof(Header);
+		if (valid) {
+			std::memcpy(&header, file.data, sizeof(Header));
+			valid = header.magic == Magic && header.format == FormatVersion && header.keyHash == keyHash
+				&& header.keySize == key.size() && sizeof(Header) + header.keySize <= file.size
+				&& header.codeOffset <= file.size && header.codeSize <= file.size - header.codeOffset;
+		}
+		if (valid && std::string_view((const char*)file.data + sizeof(Header), header.keySize) != key) {
+			// Hash collision with another expression, keep its entry.
+			MappedFile::unmap(file.data, file.size);
+			return nullptr;
+		}
+		valid = valid && header.encoderVersion == m_encoderVersion && header.cpuFeatures == m_cpuFeatures;
+		if (!valid) {
+			MappedFile::unmap(file.data, file.size);
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+			return nullptr;
+		}
+
+		unsigned char* base = file.data;
+		size_t size = file.size;
+		return CodeHandle(base + header.codeOffset, [base, size](void*) { MappedFile::unmap(base, size); });
+	}
+
+	bool CodeCache::store(std::string_view key, std::span<const unsigned char> code) const {
+		Header header {};
+		header.magic = Magic;
+		header.format = FormatVersion;
+		header.encoderVersion = m_encoderVersion;
+		header.keySize = (uint32_t)key.size();
+		header.cpuFeatures = m_cpuFeatures;
+		header.keyHash = hash(key);
+		header.codeOffset = ( sizeof(Header) + key.size() + CodeAlignment - 1 ) / CodeAlignment * CodeAlignment;
+		header.codeSize = code.size();
+
+		std::vector<char> content(header.codeOffset + code.size(), '\0');
+		std::memcpy(content.data(), &header, sizeof(Header));
+		std::memcpy(content.data() + sizeof(Header), key.data(), key.size());
+		std::memcpy(content.data() + header.codeOffset, code.data(), code.size());
+
+		// Written aside and renamed, so a concurrent load never maps a partial entry.
+		auto path = entryPath(header.keyHash);
+		auto temporary = path;
+		temporary += temporarySuffix();
+		{
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			if (!out.write(content.data(), (std::streamsize)content.size())) return false;
+		}
+		std::error_code ec;
+		std::filesystem::rename(temporary, path, ec);
+		if (ec) {
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+		return true;
+	}
+}
\ No newline at end of file
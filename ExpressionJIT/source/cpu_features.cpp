@@ -0,0 +1,63 @@
+#include "include/exprjit/cpu_features.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace exprjit
+{
+	static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) noexcept {
+#ifdef _MSC_VER
+		int r[4];
+		__cpuidex(r, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; ++i) regs[i] = (uint32_t)r[i];
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	static uint64_t xgetbv0() noexcept {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (uint64_t)edx << 32 | eax;
+#endif
+	}
+
+	static CpuFeatures detect() noexcept {
+		CpuFeatures features;
+		uint32_t regs[4];
+		cpuid(0, 0, regs);
+		uint32_t maxLeaf = regs[0];
+		if (maxLeaf < 1) return features;
+
+		cpuid(1, 0, regs);
+		features.sse41 = regs[2] & ( 1u << 19 );
+		bool osxsave = regs[2] & ( 1u << 27 );
+		bool avx = regs[2] & ( 1u << 28 );
+		bool fma = regs[2] & ( 1u << 12 );
+
+		// AVX state has to be enabled by the OS as well (XCR0 bits 1 and 2, 5-7 for AVX-512).
+		uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+		bool ymm = ( xcr0 & 0b110 ) == 0b110;
+		bool zmm = ( xcr0 & 0b11100110 ) == 0b11100110;
+
+		features.avx = avx && ymm;
+		features.fma = fma && features.avx;
+		if (maxLeaf >= 7) {
+			cpuid(7, 0, regs);
+			features.avx2 = features.avx && ( regs[1] & ( 1u << 5 ) );
+			features.avx512f = zmm && ( regs[1] & ( 1u << 16 ) );
+		}
+		return features;
+	}
+
+	const CpuFeatures& CpuFeatures::host() noexcept {
+		static const CpuFeatures features = detect();
+		return features;
+	}
+}
\ No newline at end of file
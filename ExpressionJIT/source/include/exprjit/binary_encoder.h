@@ -1,52 +1,78 @@
-#pragma once
-#include <cstdint>
-#include <vector>
-#include <type_traits>
-#include "ir.h"
-#include "opcode.h"
-
-namespace exprjit
-{
-	template<typename T>
-	concept Emittable = std::unsigned_integral<T> || std::same_as<T, Opcode>;
-
-	class BinaryEncoder {
-	public:
-		typedef unsigned char uchar_t;
-		typedef std::vector<uchar_t>& binary_t;
-
-		BinaryEncoder(binary_t bin, size_t intArgs, size_t floatArgs) 
-			: m_binary(bin), m_integerArguments(intArgs), m_floatArguments(floatArgs) { }
-
-		virtual void operator()(const ir::Instruction&) = 0;
-
-	protected:
-		template<Emittable... TValues>
-		constexpr void emit(TValues... values) {
-			( emits(values), ... );
-		}
-
-		size_t m_integerArguments;
-		size_t m_floatArguments;
-
-	private:
-		binary_t m_binary;
-
-		template<typename T>
-		constexpr void emits(T value);
-
-		template<std::unsigned_integral T>
-		void emits(T value) {
-			m_binary.push_back((unsigned char)value);
-		}
-
-		template<>
-		void emits<unsigned char>(unsigned char value) {
-			m_binary.push_back(value);
-		}
-		template<>
-		constexpr void emits<Opcode>(Opcode value) {
-			for(unsigned i = 0; i < value.size(); ++i) m_binary.push_back(value[i]);
-		}
-	};
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+#include "data_type.h"
+#include "ir.h"
+#include "opcode.h"
+
+namespace exprjit
+{
+	template<typename T>
+	concept Emittable = std::unsigned_integral<T> || std::same_as<T, Opcode>;
+
+	class BinaryEncoder {
+	public:
+		typedef unsigned char uchar_t;
+		typedef std::vector<uchar_t>& binary_t;
+
+		BinaryEncoder(binary_t bin, std::vector<DataType> arguments) 
+			: m_arguments(std::move(arguments)), m_integerArguments(0), m_floatArguments(0), m_binary(bin) { 
+			for (DataType type : m_arguments) {
+				if (type == DataType::Integer) ++m_integerArguments;
+				else ++m_floatArguments;
+			}
+		}
+
+		// Signature of integerArgs integer arguments followed by floatArgs float arguments.
+		BinaryEncoder(binary_t bin, size_t intArgs, size_t floatArgs) 
+			: BinaryEncoder(bin, signature(intArgs, floatArgs)) { }
+
+		virtual void operator()(const ir::Instruction&) = 0;
+
+		// Called after the last instruction, e.g. to append data the code refers to.
+		virtual void finalize() { }
+
+		// Number of registers of the type ir::RegisterAllocator may assign (pool registers PI0/PF0 + n).
+		virtual size_t poolSize(DataType) const noexcept = 0;
+
+		// Cycles until the result of an instruction may be used, for ir::Scheduler.
+		virtual unsigned latency(ir::Code) const noexcept { return 1; }
+
+		// Doubles one instruction works on in packed loops, 1 without packed support. Single values take twice as many.
+		virtual size_t lanes() const noexcept { return 1; }
+
+	protected:
+		template<Emittable... TValues>
+		constexpr void emit(TValues... values) {
+			( emits(values), ... );
+		}
+
+		binary_t binary() const noexcept {
+			return m_binary;
+		}
+
+		std::vector<DataType> m_arguments;
+		size_t m_integerArguments;
+		size_t m_floatArguments;
+
+	private:
+		binary_t m_binary;
+
+		template<Emittable T>
+		constexpr void emits(T value) {
+			if constexpr (std::same_as<T, Opcode>) {
+				for (unsigned i = 0; i < value.size(); ++i) m_binary.push_back(value[i]);
+			}
+			else {
+				m_binary.push_back((unsigned char)value);
+			}
+		}
+
+		static std::vector<DataType> signature(size_t intArgs, size_t floatArgs) {
+			std::vector<DataType> arguments(intArgs, DataType::Integer);
+			arguments.insert(arguments.end(), floatArgs, DataType::Float);
+			return arguments;
+		}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "expression_node.h"
+
+namespace exprjit
+{
+	// Text that identifies an expression tree regardless of how the source was formatted
+	// and of the operand order of commutative operators. Equal forms compile to equivalent code.
+	// Runs in time linear in the number of reachable nodes.
+	std::string canonicalForm(const std::vector<ExpressionNode>& expr, size_t root);
+}
\ No newline at end of file
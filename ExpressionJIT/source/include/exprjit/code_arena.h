@@ -0,0 +1,61 @@
+#pragma once
+#include <span>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace exprjit
+{
+	// Packs compiled functions into large executable regions.
+	// Every region is mapped twice: code is written through the writable view and executed
+	// through the read/execute one, so publishing a new function never changes the protection
+	// of pages other functions may be running from.
+	class CodeArena {
+	public:
+		constexpr static size_t RegionSize = 1 << 20;
+		constexpr static size_t BlockAlignment = 32; // of the constant pools of 256-bit code
+
+		static CodeArena& instance() noexcept;
+
+		void* allocate(std::span<const unsigned char> code);
+		bool free(void* ptr) noexcept;
+
+		// Bytes occupied by live functions (rounded up to BlockAlignment).
+		size_t used() const noexcept;
+		// Bytes mapped from the OS for all regions.
+		size_t reserved() const noexcept;
+
+		CodeArena(const CodeArena&) = delete;
+		CodeArena& operator=(const CodeArena&) = delete;
+
+	private:
+		struct Region {
+			unsigned char* writable;
+			unsigned char* executable;
+			size_t size;
+			size_t top;
+			void* mapping;
+		};
+
+		struct Block {
+			size_t size;
+			size_t region;
+			bool live; // allocated, not on a free list
+		};
+
+		mutable std::mutex m_mutex;
+		std::vector<Region> m_regions;
+		std::unordered_map<const void*, Block> m_blocks;
+		std::map<size_t, std::vector<unsigned char*>> m_free; // block size -> freed blocks
+		size_t m_used;
+		size_t m_reserved;
+
+		CodeArena() noexcept : m_used(0), m_reserved(0) { }
+
+		unsigned char* take(size_t size, size_t& region);
+		size_t mapRegion(size_t size);
+		unsigned char* writable(unsigned char* executable, size_t region) const noexcept;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include <span>
+#include <string_view>
+#include <filesystem>
+#include <cstdint>
+#include "function_allocator.h"
+
+namespace exprjit
+{
+	// Persistent store of emitted machine code, one file per key.
+	// Entries are mapped straight from disk as executable memory, so stored code has to be position independent.
+	// An entry is only used by the encoder version and CPU features it was produced with, stale entries are removed on lookup.
+	class CodeCache {
+	public:
+		constexpr static uint32_t FormatVersion = 1;
+
+		CodeCache(std::filesystem::path directory, uint32_t encoderVersion);
+
+		// Returns an empty handle if there is no valid entry for the key.
+		CodeHandle load(std::string_view key) const;
+		// Returns false if the entry could not be written, the cache is best effort.
+		bool store(std::string_view key, std::span<const unsigned char> code) const;
+
+		const std::filesystem::path& directory() const noexcept {
+			return m_directory;
+		}
+
+	private:
+		struct Header {
+			uint32_t magic;
+			uint32_t format;
+			uint32_t encoderVersion;
+			uint32_t keySize;
+			uint64_t cpuFeatures;
+			uint64_t keyHash;
+			uint64_t codeOffset;
+			uint64_t codeSize;
+		};
+
+		constexpr static uint32_t Magic = 0x54494A45; // "EJIT"
+		constexpr static size_t CodeAlignment = 64;
+
+		std::filesystem::path m_directory;
+		uint32_t m_encoderVersion;
+		uint64_t m_cpuFeatures;
+
+		std::filesystem::path entryPath(uint64_t keyHash) const;
+		static uint64_t hash(std::string_view key) noexcept;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace exprjit
+{
+	// Fast and Default reduce arguments with |x| < 2^20 * pi/2 and give NaN beyond. Single precision code reduces
+	// exactly for |x| < 2^7 * pi/2 only, above that its error grows to ~6e-2 without FMA.
+	enum class TrigAccuracy {
+		Fast,		// ~1e-7 absolute error, shorter reduction and polynomials
+		Default,	// ~2 ulp
+		Strict		// calls std::sin/std::cos of the host, bit-identical to them
+	};
+
+	// Per-compile code generation settings.
+	struct CompileOptions {
+		TrigAccuracy trigAccuracy = TrigAccuracy::Default;
+		// Results may differ from IEEE evaluation of the expression as written: + and * chains are reassociated
+		// into balanced trees, division by a literal becomes multiplication by its reciprocal, multiply-adds are
+		// contracted, and NaN, infinities and the sign of zero are assumed not to matter.
+		bool fastMath = false;
+
+		// False when the code refers to addresses in this process and must not be persisted.
+		// Parameter blocks are passed to the code, they do not count.
+		bool relocatable() const noexcept {
+			return trigAccuracy != TrigAccuracy::Strict;
+		}
+	};
+}
\ No newline at end of file
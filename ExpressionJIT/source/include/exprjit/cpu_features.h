@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+namespace exprjit
+{
+	// Instruction set extensions of the host CPU that code generation may depend on.
+	struct CpuFeatures {
+		bool sse41 = false;
+		bool avx = false;
+		bool avx2 = false;
+		bool fma = false;
+		bool avx512f = false; // detected only, X86_64 emits no AVX-512 code
+
+		static const CpuFeatures& host() noexcept;
+
+		uint64_t bits() const noexcept {
+			return (uint64_t)sse41 | (uint64_t)avx << 1 | (uint64_t)avx2 << 2 | (uint64_t)fma << 3 | (uint64_t)avx512f << 4;
+		}
+	};
+}
\ No newline at end of file
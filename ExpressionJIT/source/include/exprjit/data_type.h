@@ -1,8 +1,20 @@
-#pragma once
-
-namespace exprjit
-{
-	enum class DataType {
-		Integer = 1, Float = 2
-	};
+#pragma once
+
+namespace exprjit
+{
+	// Float is a double, Single a 32-bit float.
+	enum class DataType {
+		Integer = 1, Float = 2, Single = 3
+	};
+
+	constexpr bool isFloat(DataType type) noexcept {
+		return type != DataType::Integer;
+	}
+
+	// Type of an operation on a and b: the wider one, Integer < Single < Float.
+	constexpr DataType promote(DataType a, DataType b) noexcept {
+		if (a == DataType::Float || b == DataType::Float) return DataType::Float;
+		if (a == DataType::Single || b == DataType::Single) return DataType::Single;
+		return DataType::Integer;
+	}
 }
\ No newline at end of file
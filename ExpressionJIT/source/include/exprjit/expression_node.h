@@ -1,79 +1,125 @@
-#pragma once
-#include <cstdint>
-#include "data_type.h"
-
-namespace exprjit
-{
-	struct ExpressionNode {
-		enum class Type {
-			Binop,
-			Unop,
-			Literal,
-			Argument
-		};
-		enum class Binop {
-			Add, Subtract, Multiply, Divide, Modulo
-		};
-		enum class Unop {
-			IToF, FToI, Negate, Abs, Sin, Cos, Floor
-		};
-
-		Type type;
-
-		union {
-			struct {
-				size_t lhs;
-				size_t rhs;
-				Binop op;
-			} binop;
-
-			struct {
-				size_t operand;
-				Unop op;
-			} unop;
-
-			struct {
-				uint64_t value;
-				DataType type;
-			} literal;
-
-			struct {
-				unsigned index;
-				DataType type;
-			} argument;
-		};
-
-		static ExpressionNode makeBinop(Binop op, size_t lhs, size_t rhs) {
-			ExpressionNode node;
-			node.type = Type::Binop;
-			node.binop.op = op;
-			node.binop.lhs = lhs;
-			node.binop.rhs = rhs;
-			return node;
-		}
-		static ExpressionNode makeUnop(Unop op, size_t operand) {
-			ExpressionNode node;
-			node.type = Type::Unop;
-			node.unop.op = op;
-			node.unop.operand = operand;
-			return node;
-		}
-		static ExpressionNode makeLiteral(uint64_t value, DataType type) {
-			ExpressionNode node;
-			node.type = Type::Literal;
-			node.literal.value = value;
-			node.literal.type = type;
-			return node;
-		}
-		static ExpressionNode makeArgument(unsigned argindex, DataType type) {
-			ExpressionNode node;
-			node.type = Type::Argument;
-			node.argument.index = argindex;
-			node.argument.type = type;
-			return node;
-		}
-
-	private:
-		ExpressionNode() = default;
-	};
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "data_type.h"
+
+namespace exprjit
+{
+	struct ExpressionNode {
+		enum class Type {
+			Binop,
+			Unop,
+			Literal,
+			Argument,
+			Parameter	// float, read from the ParameterBlock at evaluation
+		};
+		enum class Binop {
+			Add, Subtract, Multiply, Divide, Modulo
+		};
+		enum class Unop {
+			IToF, FToI, Negate, Abs, Sin, Cos, Floor
+		};
+
+		Type type;
+
+		union {
+			struct {
+				size_t lhs;
+				size_t rhs;
+				Binop op;
+			} binop;
+
+			struct {
+				size_t operand;
+				Unop op;
+			} unop;
+
+			struct {
+				uint64_t value;		// int64_t, or the bits of a double, rounded to float for Single
+				DataType type;
+				bool typed;			// the type counts toward the kernel's precision like an argument's (bound arguments)
+			} literal;
+
+			struct {
+				unsigned index;
+				DataType type;
+			} argument;
+
+			struct {
+				unsigned index;
+			} parameter;
+		};
+
+		static ExpressionNode makeBinop(Binop op, size_t lhs, size_t rhs) {
+			ExpressionNode node;
+			node.type = Type::Binop;
+			node.binop.op = op;
+			node.binop.lhs = lhs;
+			node.binop.rhs = rhs;
+			return node;
+		}
+		static ExpressionNode makeUnop(Unop op, size_t operand) {
+			ExpressionNode node;
+			node.type = Type::Unop;
+			node.unop.op = op;
+			node.unop.operand = operand;
+			return node;
+		}
+		static ExpressionNode makeLiteral(uint64_t value, DataType type, bool typed = false) {
+			ExpressionNode node;
+			node.type = Type::Literal;
+			node.literal.value = value;
+			node.literal.type = type;
+			node.literal.typed = typed;
+			return node;
+		}
+		static ExpressionNode makeArgument(unsigned argindex, DataType type) {
+			ExpressionNode node;
+			node.type = Type::Argument;
+			node.argument.index = argindex;
+			node.argument.type = type;
+			return node;
+		}
+
+		static ExpressionNode makeParameter(unsigned index) {
+			ExpressionNode node;
+			node.type = Type::Parameter;
+			node.parameter.index = index;
+			return node;
+		}
+
+	private:
+		ExpressionNode() = default;
+	};
+
+	// Precision of all float operations of an expression, literals and parameters included (see ir::ValueGraph):
+	// Float, or Single when nothing read or returned is a double and something is Single. Typed literals count as
+	// what they were, so binding an argument or simplifying does not change the precision.
+	inline DataType floatPrecision(const std::vector<ExpressionNode>& expr, size_t root, DataType resultType) {
+		DataType type = resultType;
+		std::vector<size_t> pending { root };
+		while (!pending.empty() && type != DataType::Float) {
+			const ExpressionNode& node = expr[pending.back()];
+			pending.pop_back();
+			switch (node.type) {
+				case ExpressionNode::Type::Binop:
+					pending.push_back(node.binop.lhs);
+					pending.push_back(node.binop.rhs);
+					break;
+				case ExpressionNode::Type::Unop:
+					pending.push_back(node.unop.operand);
+					break;
+				case ExpressionNode::Type::Argument:
+					type = promote(type, node.argument.type);
+					break;
+				case ExpressionNode::Type::Literal:
+					if (node.literal.typed && isFloat(node.literal.type)) type = promote(type, node.literal.type);
+					break;
+				default:
+					break;
+			}
+		}
+		return type == DataType::Single ? DataType::Single : DataType::Float;
+	}
 }
\ No newline at end of file
@@ -1,51 +1,160 @@
-#pragma once
-#include <span>
-#include <type_traits>
-#include <exception>
-#include <cstdint>
-#include "function_allocator.h"
-
-namespace exprjit
-{
-	template<typename UnusedType>
-	class Function;
-
-	template<typename ReturnType, typename... ArgumentTypes>
-	class Function<ReturnType(ArgumentTypes...)> {
-	public:
-		typedef ReturnType(*function_type)(ArgumentTypes...);
-
-		Function(const std::span<unsigned char>& binary) { 
-			m_memory = FunctionAllocator::allocate(binary);
-		}
-
-		Function(Function&& f) noexcept : m_memory(f.m_memory) {
-			f.m_memory = nullptr;
-		}
-
-		Function& operator=(Function&& f) noexcept {
-			if (m_memory != nullptr) FunctionAllocator::free(m_memory);
-
-			m_memory = f.m_memory;
-			f.m_memory = nullptr;
-		}
-
-		~Function() noexcept {
-			FunctionAllocator::free(m_memory); // check errors
-		}
-
-		function_type ptr() {
-			return m_function;
-		}
-
-		ReturnType operator()(ArgumentTypes... args) const noexcept {
-			return m_function(args...);
-		}
-
-	private:
-		union {
-			ReturnType (*m_function)(ArgumentTypes...);
-			void* m_memory;
-		};
-	};
+#pragma once
+#include <span>
+#include <type_traits>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+#include "function_allocator.h"
+#include "layout.h"
+#include "parameter_block.h"
+
+namespace exprjit
+{
+	template<typename UnusedType>
+	class Function;
+
+	// Functions pass the address of the parameter block after the declared arguments, code not reading
+	// parameters ignores it.
+	template<typename ReturnType, typename... ArgumentTypes>
+	class Function<ReturnType(ArgumentTypes...)> {
+	public:
+		typedef ReturnType(*function_type)(ArgumentTypes..., const ParameterBlock::Value* parameters);
+
+		Function(const std::span<unsigned char>& binary, const ParameterBlock* parameters = nullptr) 
+			: Function(FunctionAllocator::allocateShared(binary), parameters) { }
+
+		// Shares already allocated code, copies of a Function share it as well.
+		explicit Function(CodeHandle code, const ParameterBlock* parameters = nullptr) noexcept 
+			: m_code(std::move(code)), m_function((function_type)m_code.get()), m_parameters(parameters ? parameters->data() : nullptr) { }
+
+		Function(const Function&) = default;
+		Function& operator=(const Function&) = default;
+
+		Function(Function&& f) noexcept : m_code(std::move(f.m_code)), m_function(f.m_function), m_parameters(f.m_parameters) {
+			f.m_function = nullptr;
+		}
+
+		Function& operator=(Function&& f) noexcept {
+			m_code = std::move(f.m_code);
+			m_function = f.m_function;
+			m_parameters = f.m_parameters;
+			f.m_function = nullptr;
+			return *this;
+		}
+
+		function_type ptr() {
+			return m_function;
+		}
+
+		const CodeHandle& code() const noexcept {
+			return m_code;
+		}
+
+		ReturnType operator()(ArgumentTypes... args) const noexcept {
+			return m_function(args..., m_parameters);
+		}
+
+	private:
+		CodeHandle m_code;
+		function_type m_function;
+		const ParameterBlock::Value* m_parameters;
+	};
+
+	template<typename UnusedType>
+	class BatchFunction;
+
+	// Kernel compiled by Generator::batch: out[i] = f(args[0][i], args[1][i], ...) for i < n.
+	// out may be one of the argument arrays, other overlaps are not allowed. Compiled for a BatchLayout, the pointers
+	// are the base addresses its offsets and strides apply to, several arguments may share one.
+	template<typename ReturnType, typename... ArgumentTypes>
+	class BatchFunction<ReturnType(ArgumentTypes...)> {
+		template<typename T> constexpr static bool element = sizeof(T) == 8 || std::is_same_v<T, float>;
+		static_assert(element<ReturnType> && ( element<ArgumentTypes> && ... ), "Batch kernels take 8-byte elements or floats.");
+	public:
+		typedef void(*function_type)(const void* const* args, ReturnType* out, size_t n, const ParameterBlock::Value* parameters);
+
+		explicit BatchFunction(CodeHandle code, const ParameterBlock* parameters = nullptr) noexcept 
+			: m_code(std::move(code)), m_function((function_type)m_code.get()), m_parameters(parameters ? parameters->data() : nullptr) { }
+
+		BatchFunction(const BatchFunction&) = default;
+		BatchFunction& operator=(const BatchFunction&) = default;
+
+		BatchFunction(BatchFunction&& f) noexcept : m_code(std::move(f.m_code)), m_function(f.m_function), m_parameters(f.m_parameters) {
+			f.m_function = nullptr;
+		}
+
+		BatchFunction& operator=(BatchFunction&& f) noexcept {
+			m_code = std::move(f.m_code);
+			m_function = f.m_function;
+			m_parameters = f.m_parameters;
+			f.m_function = nullptr;
+			return *this;
+		}
+
+		function_type ptr() {
+			return m_function;
+		}
+
+		const CodeHandle& code() const noexcept {
+			return m_code;
+		}
+
+		void operator()(const void* const* args, ReturnType* out, size_t n) const noexcept {
+			m_function(args, out, n, m_parameters);
+		}
+
+		void operator()(ReturnType* out, size_t n, const ArgumentTypes*... args) const noexcept {
+			const void* columns[] { args..., nullptr };
+			m_function(columns, out, n, m_parameters);
+		}
+
+	private:
+		CodeHandle m_code;
+		function_type m_function;
+		const ParameterBlock::Value* m_parameters;
+	};
+
+	// Kernel compiled by Generator::grid: f(x, y) of every point of the grid, row by row, to out in the layout
+	// it was compiled for. Other bytes of out are left as they are.
+	template<typename ReturnType>
+	class GridFunction {
+		static_assert(sizeof(ReturnType) == 8 || std::is_same_v<ReturnType, float>, "Grid kernels write 8-byte elements or floats.");
+	public:
+		typedef void(*function_type)(const Grid* grid, void* out, const ParameterBlock::Value* parameters);
+
+		explicit GridFunction(CodeHandle code, const ParameterBlock* parameters = nullptr) noexcept 
+			: m_code(std::move(code)), m_function((function_type)m_code.get()), m_parameters(parameters ? parameters->data() : nullptr) { }
+
+		GridFunction(const GridFunction&) = default;
+		GridFunction& operator=(const GridFunction&) = default;
+
+		GridFunction(GridFunction&& f) noexcept : m_code(std::move(f.m_code)), m_function(f.m_function), m_parameters(f.m_parameters) {
+			f.m_function = nullptr;
+		}
+
+		GridFunction& operator=(GridFunction&& f) noexcept {
+			m_code = std::move(f.m_code);
+			m_function = f.m_function;
+			m_parameters = f.m_parameters;
+			f.m_function = nullptr;
+			return *this;
+		}
+
+		function_type ptr() {
+			return m_function;
+		}
+
+		const CodeHandle& code() const noexcept {
+			return m_code;
+		}
+
+		void operator()(const Grid& grid, void* out) const noexcept {
+			m_function(&grid, out, m_parameters);
+		}
+
+	private:
+		CodeHandle m_code;
+		function_type m_function;
+		const ParameterBlock::Value* m_parameters;
+	};
 }
\ No newline at end of file
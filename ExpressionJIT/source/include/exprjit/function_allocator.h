@@ -1,24 +1,35 @@
-#pragma once
-#include <span>
-#include <exception>
-#include <cstdint>
-
-namespace exprjit
-{
-	struct FunctionAllocator {
-		static void* allocate(const std::span<unsigned char>&);
-		static bool free(void*) noexcept;
-	};
-
-	class VirtualProtectException : public std::exception {
-	public:
-		uint32_t error;
-		VirtualProtectException(uint32_t error) noexcept : error(error) { }
-	};
-
-	class VirtualAllocException : public std::exception {
-	public:
-		uint32_t error;
-		VirtualAllocException(uint32_t error) noexcept : error(error) { }
-	};
+#pragma once
+#include <span>
+#include <memory>
+#include <exception>
+#include <cstdint>
+
+namespace exprjit
+{
+	// Shared ownership of a block of executable code, released through FunctionAllocator.
+	typedef std::shared_ptr<void> CodeHandle;
+
+	struct FunctionAllocator {
+		static void* allocate(const std::span<unsigned char>&);
+		static bool free(void*) noexcept;
+
+		static CodeHandle allocateShared(const std::span<unsigned char>& binary) {
+			return CodeHandle(allocate(binary), &FunctionAllocator::free);
+		}
+
+		static size_t usedBytes() noexcept;
+		static size_t reservedBytes() noexcept;
+	};
+
+	class VirtualProtectException : public std::exception {
+	public:
+		uint32_t error;
+		VirtualProtectException(uint32_t error) noexcept : error(error) { }
+	};
+
+	class VirtualAllocException : public std::exception {
+	public:
+		uint32_t error;
+		VirtualAllocException(uint32_t error) noexcept : error(error) { }
+	};
 }
\ No newline at end of file
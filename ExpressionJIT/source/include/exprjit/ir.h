@@ -1,75 +1,198 @@
-#pragma once
-#include <cstdint>
-
-namespace exprjit::ir
-{
-	enum class VirtualRegister {
-		I0, I1, IR, F0, F1, FR,
-		IA0, IA1, IA2, IA3,
-		FA0, FA1, FA2, FA3
-	};
-
-	struct Operand {
-		bool immediate;
-		union {
-			uint64_t value;
-			VirtualRegister  reg;
-		};
-
-		Operand(uint64_t value) : immediate(true), value(value) { }
-		Operand(VirtualRegister vr) : immediate(false), reg(vr) { }
-
-		friend struct Instruction;
-
-	private:
-		Operand() = default;
-	};
-
-	enum class Code {
-		None,
-		Ret,
-
-		ILoadR,//VR  : Src       IMM : Value		Load literal to reg.
-		ILoad, //IMM : Value						Push literal on stack.
-		IArg,  //IMM : Index						Push argument on stack.
-		IPush, //VR  : Src						Push virt reg on stack.
-		IPop,  //VR  : Dst						Pop virt reg from stack.
-		IMov,  //VR  : Src		 VR  : Dst		Assign VR[Src] value of VR[Dst].
-		IAdd,
-		ISub,
-		IMul,
-		IDiv,
-		IMod,
-		INeg,
-
-		IAbs,
-
-		FLoad,
-		FArg,
-		FPush,
-		FPop,
-		FMov,
-		FAdd,
-		FSub,
-		FMul,
-		FDiv,
-		FMod,
-		FNeg,
-
-		FAbs,
-		FSin,
-		FCos,
-		FTan,
-		FFloor,
-
-		IToF, //VRf : Dst		VRi : SRC			Move i-val from VRi to VRf.
-		FToI, //VRi : Dst		VRf	: SRC			Move f-val from VRf to VRi.
-	};
-
-	struct Instruction {
-		Code code;
-		Operand operands[2];
-
-		Instruction(Code code) : code(code) {}
-	};
-}
\ No newline at end of file
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "data_type.h"
+
+namespace exprjit::ir
+{
+	enum class VirtualRegister : uint32_t {
+		I0, I1, IR, F0, F1, FR,
+		IA0, IA1, IA2, IA3,
+		FA0, FA1, FA2, FA3,
+
+		PI0 = 0x100,	// PI0 + n: n-th register of the target's integer pool, assigned by RegisterAllocator.
+		PF0 = 0x200,	// PF0 + n: n-th register of the target's float pool.
+		V0 = 0x10000	// V0 + n: unbounded virtual registers produced by Generator.
+	};
+
+	constexpr VirtualRegister vreg(size_t n) noexcept {
+		return VirtualRegister((uint32_t)VirtualRegister::V0 + (uint32_t)n);
+	}
+	constexpr bool isVirtual(VirtualRegister vr) noexcept {
+		return vr >= VirtualRegister::V0;
+	}
+	constexpr size_t vregIndex(VirtualRegister vr) noexcept {
+		return (uint32_t)vr - (uint32_t)VirtualRegister::V0;
+	}
+	constexpr VirtualRegister poolRegister(DataType type, size_t n) noexcept {
+		return VirtualRegister((uint32_t)( type == DataType::Integer ? VirtualRegister::PI0 : VirtualRegister::PF0 ) + (uint32_t)n);
+	}
+	constexpr bool isPoolRegister(VirtualRegister vr) noexcept {
+		return vr >= VirtualRegister::PI0 && vr < VirtualRegister::V0;
+	}
+	constexpr size_t poolIndex(VirtualRegister vr) noexcept {
+		return (uint32_t)vr - (uint32_t)( vr >= VirtualRegister::PF0 ? VirtualRegister::PF0 : VirtualRegister::PI0 );
+	}
+
+	struct Operand {
+		bool immediate;
+		union {
+			uint64_t value;
+			VirtualRegister  reg;
+		};
+
+		Operand(uint64_t value) : immediate(true), value(value) { }
+		Operand(VirtualRegister vr) : immediate(false), reg(vr) { }
+
+		friend struct Instruction;
+
+	private:
+		Operand() = default;
+	};
+
+	enum class Code {
+		None,
+		Ret,
+		Enter, //IMM : Pool mask	IMM : Slots		IMM : Slot lanes		Function prologue: saves used pool registers (integer mask in the low 32 bits), reserves spill slots.
+		Loop,  //IMM : Lanes								Loop head, LoopEnd jumps back here. Float instructions up to LoopEnd work on Lanes elements at once.
+		LoopTest,//VRi : Count	 IMM : Step		Leaves the loop, past its LoopEnd, when Count < Step.
+		LoopEnd,//										Closes the innermost open loop.
+		Precision,//IMM : DataType						Float instructions that follow work on doubles (Float, the default) or Single values.
+
+		ILoadR,//VR  : Dst       IMM : Value		Load literal to reg.
+		ILoad, //IMM : Value						Push literal on stack.
+		IArg,  //IMM : Index						Push argument on stack.
+		IArgR, //VR  : Dst		 IMM : Index		Load argument to reg.
+		IBlockR,//VRi : Dst								Address of the parameter block, the last argument of the signature, in a register or on the stack.
+		IPush, //VR  : Src						Push virt reg on stack.
+		IPop,  //VR  : Dst						Pop virt reg from stack.
+		IMov,  //VR  : Dst		 VR  : Src		Assign VR[Dst] value of VR[Src].
+		ISpill,//VR  : Src		 IMM : Slot		Store reg to spill slot.
+		IFill, //VR  : Dst		 IMM : Slot		Load reg from spill slot.
+		ILoadM,//VR  : Dst		 VRi : Base		IMM : Offset		Dst = the 8 bytes at Base + Offset.
+		IStoreM,//VR : Src		 VRi : Base		IMM : Offset		Stores Src to Base + Offset.
+		IAdd,
+		ISub,
+		IMul,
+		IDiv,
+		IMod,
+		IAddI, //VR  : Dst		 IMM : Value		Add a 32-bit literal.
+		ISubI,
+		IMulI,
+		IDivI, //VR  : Dst		 IMM : Divisor		Divide by a literal.
+		IModI, //VR  : Dst		 IMM : Divisor		Remainder of division by a literal.
+		ILea,  //VR  : Dst, base	 VR  : Index	IMM : Scale | Disp << 32		Dst += Index * Scale (1, 2, 4, 8) + Disp (signed 32-bit).
+		INeg,
+
+		IAbs,
+
+		FLoadR,
+		FLoad,
+		FArg,
+		FArgR,
+		FParamR, //VRf : Dst	VRi : Block		IMM : Index		Load a parameter from the block.
+		FLoadM,//VRf : Dst		 VRi : Base		IMM : Offset | Size << 32 | Stride << 40		Dst = the Size-byte element (4 or 8) at Base + Offset, not converted.
+		FStoreM,//VRf : Src		 VRi : Base		IMM : Offset | Size << 32 | Stride << 40		Stores Src there. In packed loops lane k is at Offset + k * Stride, Size apart when Stride is 0.
+		FBroadcast,//VRf : Dst	 IMM : Size		Copies the first Size-byte element to the other lanes, for packed loops.
+		FIota, //VRf : Dst								Lane k = k, 0 outside packed loops.
+		FPush,
+		FPop,
+		FMov,
+		FSpill,
+		FFill,
+		FAdd,
+		FSub,
+		FMul,
+		FDiv,
+		FMod,
+		FAddK, //VRf : Dst		 IMM : Value		Add a literal, read from memory.
+		FMulK,
+		FDivK,
+		FMulAddK, //VRf : Dst		VRf : Factor	IMM : Value		Dst = Dst * Factor + Value, fused where the target can (fast math).
+		FMulKAdd, //VRf : Dst		VRf : Factor	IMM : Value		Dst = Dst + Factor * Value, fused where the target can (fast math).
+		FNeg,
+
+		FAbs,
+		FSin,
+		FCos,
+		FSinCos,//VRf : Sin, src	VRf : Cos			Both of one operand, sharing the range reduction.
+		FTan,
+		FFloor,
+		FCeil,
+
+		IToF, //VRf : Dst		VRi : SRC			Move i-val from VRi to VRf.
+		FToI, //VRi : Dst		VRf	: SRC			Move f-val from VRf to VRi.
+		SToF, //VRf : Dst								Single to double in place, in Float code.
+		FToS, //VRf : Dst								Double to Single in place, in Float code.
+	};
+
+	struct Instruction {
+		Code code;
+		Operand operands[3]; // the third one only ever holds an immediate
+
+		Instruction(Code code) : code(code) {}
+		Instruction(Code code, Operand a) : code(code), operands { a, Operand(), Operand() } {}
+		Instruction(Code code, Operand a, Operand b) : code(code), operands { a, b, Operand() } {}
+		Instruction(Code code, Operand a, Operand b, Operand c) : code(code), operands { a, b, c } {}
+	};
+
+	// How an instruction accesses its register operands.
+	enum class Access {
+		None,		// Unused or immediate.
+		Use,
+		Def,
+		UseDef		// Read and overwritten with the result.
+	};
+
+	struct OperandInfo {
+		Access access;
+		DataType type;
+	};
+
+	inline std::array<OperandInfo, 2> operandInfo(Code code) noexcept {
+		constexpr OperandInfo none { Access::None, DataType::Integer };
+		constexpr OperandInfo iuse { Access::Use, DataType::Integer }, idef { Access::Def, DataType::Integer }, iud { Access::UseDef, DataType::Integer };
+		constexpr OperandInfo fuse { Access::Use, DataType::Float }, fdef { Access::Def, DataType::Float }, fud { Access::UseDef, DataType::Float };
+
+		switch (code) {
+			case Code::ILoadR: case Code::IArgR: case Code::IBlockR: case Code::IPop: case Code::IFill:
+				return { idef, none };
+			case Code::FLoadR: case Code::FArgR: case Code::FPop: case Code::FFill: case Code::FIota:
+				return { fdef, none };
+			case Code::IPush: case Code::ISpill:
+				return { iuse, none };
+			case Code::FPush: case Code::FSpill:
+				return { fuse, none };
+			case Code::IMov:
+				return { idef, iuse };
+			case Code::FMov:
+				return { fdef, fuse };
+			case Code::IAdd: case Code::ISub: case Code::IMul: case Code::IDiv: case Code::IMod: case Code::ILea:
+				return { iud, iuse };
+			case Code::INeg: case Code::IAbs: case Code::IAddI: case Code::ISubI: case Code::IMulI: case Code::IDivI: case Code::IModI:
+				return { iud, none };
+			case Code::FAdd: case Code::FSub: case Code::FMul: case Code::FDiv: case Code::FMod: case Code::FMulAddK: case Code::FMulKAdd:
+				return { fud, fuse };
+			case Code::FNeg: case Code::FAbs: case Code::FBroadcast: case Code::FSin: case Code::FCos: case Code::FTan: case Code::FFloor: case Code::FCeil:
+			case Code::FAddK: case Code::FMulK: case Code::FDivK: case Code::SToF: case Code::FToS:
+				return { fud, none };
+			case Code::FSinCos:
+				return { fud, fdef };
+			case Code::IToF: case Code::FParamR: case Code::FLoadM:
+				return { fdef, iuse };
+			case Code::ILoadM:
+				return { idef, iuse };
+			case Code::IStoreM:
+				return { iuse, iuse };
+			case Code::FStoreM:
+				return { fuse, iuse };
+			case Code::LoopTest:
+				return { iuse, none };
+			case Code::FToI:
+				return { idef, fuse };
+			default:
+				return { none, none };
+		}
+	}
+}
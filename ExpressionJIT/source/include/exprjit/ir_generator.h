@@ -1,30 +1,71 @@
-#pragma once
-#include <vector>
-#include "data_type.h"
-#include "expression_node.h"
-#include "ir.h"
-
-namespace exprjit::ir
-{
-	class Generator {
-	public:
-		Generator(const std::vector<ExpressionNode>& expr, size_t root, std::vector<ir::Instruction>& ir, DataType resultType) 
-			: m_expression(expr), m_exprRoot(root), m_ir(ir), m_resultType(resultType) { }
-
-		void operator()();
-
-	private:
-		const std::vector<ExpressionNode>& m_expression;
-		std::vector<ir::Instruction>& m_ir;
-		size_t m_exprRoot;
-		DataType m_resultType;
-
-		DataType gen(size_t) noexcept;
-		void pop(VirtualRegister) noexcept;
-		void push(VirtualRegister) noexcept;
-		void itof(VirtualRegister d, VirtualRegister i) noexcept;
-		void ftoi(VirtualRegister i, VirtualRegister d) noexcept;
-
-		VirtualRegister popa(DataType type, DataType resT, int reg) noexcept;
-	};
-}
\ No newline at end of file
+#pragma once
+#include <vector>
+#include "data_type.h"
+#include "expression_node.h"
+#include "ir.h"
+#include "ir_value_graph.h"
+#include "ir_selector.h"
+#include "compile_options.h"
+#include "layout.h"
+
+namespace exprjit::ir
+{
+	// Lowers an expression to instructions over unbounded virtual registers (V0 + n) through its ValueGraph,
+	// so common subexpressions are evaluated once, one instruction per Selector tile.
+	// RegisterAllocator maps the registers onto the target afterwards.
+	//
+	// batch lowers a loop kernel instead, void(const void* const* args, void* out, size_t n) with three integer
+	// arguments at the target: out[i] = f(args[0][i], args[1][i], ...) for i < n, columns of 4-byte Single elements
+	// and 8-byte ones of the other types, laid out as given (contiguous by default).
+	// Values not depending on the arguments are computed once before the loop; the body is repeated unroll
+	// times per iteration, the remaining elements go one at a time through a last loop. Float expressions
+	// of packable instructions are evaluated lanes elements per instruction where lanes > 1 (BinaryEncoder::lanes),
+	// twice as many in Single precision.
+	//
+	// grid lowers void(const Grid* grid, void* out), two integer arguments at the target, evaluating the expression
+	// of x (argument 0) and y (argument 1) over the grid into out in the given layout, rows one after the other.
+	// The coordinates are counted in the kernel; values depending on neither are computed once, those of y alone
+	// once per row. Loops and packing go as in batch, the whole row loop is packed when its body can be.
+	class Generator {
+	public:
+		constexpr static size_t DefaultUnroll = 4;
+
+		Generator(const std::vector<ExpressionNode>& expr, size_t root, std::vector<ir::Instruction>& ir, DataType resultType,
+			const CompileOptions& options = {}) 
+			: m_expression(expr), m_exprRoot(root), m_ir(ir), m_resultType(resultType), m_options(options), m_registers(0) { }
+
+		void operator()();
+		void operator()(const ValueGraph& graph);
+		void batch(size_t unroll = DefaultUnroll, size_t lanes = 1, const BatchLayout& layout = {});
+		void batch(const ValueGraph& graph, size_t unroll = DefaultUnroll, size_t lanes = 1, const BatchLayout& layout = {});
+		void grid(const Layout& layout, size_t unroll = DefaultUnroll, size_t lanes = 1);
+		void grid(const ValueGraph& graph, const Layout& layout, size_t unroll = DefaultUnroll, size_t lanes = 1);
+
+	private:
+		constexpr static VirtualRegister Pending = VirtualRegister::V0;
+
+		const std::vector<ExpressionNode>& m_expression;
+		std::vector<ir::Instruction>& m_ir;
+		size_t m_exprRoot;
+		DataType m_resultType;
+		CompileOptions m_options;
+		size_t m_registers;
+
+		std::vector<Tile> m_tiles;
+		std::vector<size_t> m_uses;				// uses of each value not lowered yet
+		std::vector<size_t> m_need;				// Sethi-Ullman number of each tile
+		std::vector<VirtualRegister> m_values;	// register holding each lowered value, V0 before
+		std::vector<size_t> m_sinCos;			// FCos value of the same operand for each FSin and vice versa, None if unpaired
+		std::vector<VirtualRegister> m_columns;	// batch: pointer to each argument's next element, empty otherwise
+		std::vector<Layout> m_layouts;			// batch: of each column, with the stride filled in
+		uint64_t m_element = 0;					// batch and grid: index of the element the body copy works on
+
+		VirtualRegister gen(const ValueGraph& graph, size_t v);
+		VirtualRegister consume(const ValueGraph& graph, size_t v);
+		VirtualRegister genSinCos(const ValueGraph& graph, size_t v);
+		void pairSinCos(const ValueGraph& graph);
+		void prepare(const ValueGraph& graph);
+		void number();
+		VirtualRegister allocate() noexcept;
+	};
+}
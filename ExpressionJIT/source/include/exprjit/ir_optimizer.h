@@ -1,18 +1,31 @@
-#pragma once
-#include <vector>
-#include "ir.h"
-
-namespace exprjit::ir
-{
-	class Optimizer {
-	public:
-		Optimizer(std::vector<ir::Instruction>& ir) : m_ir(ir) { }
-	
-		void operator()();
-
-	private:
-		std::vector<ir::Instruction>& m_ir;
-
-		static std::vector<size_t(*)( std::vector<Instruction>& ir, size_t start )> optimizations;
-	};
-}
\ No newline at end of file
+#pragma once
+#include <vector>
+#include "ir.h"
+
+namespace exprjit::ir
+{
+	// Peephole optimizer over the virtual register form. Instructions are copied to a new buffer in one pass,
+	// after each one the rules are tried on the tail of that buffer, and again after every rewrite so rewrites cascade.
+	// Every rewrite removes or simplifies instructions, the pass stays linear in the IR size.
+	class Optimizer {
+	public:
+		Optimizer(std::vector<ir::Instruction>& ir) : m_ir(ir) { }
+	
+		void operator()();
+
+	private:
+		// Tries to rewrite the last `length` instructions of out, returns whether it did.
+		struct Rule {
+			size_t length;
+			bool(*apply)( Optimizer& optimizer, std::vector<Instruction>& out );
+		};
+
+		std::vector<ir::Instruction>& m_ir;
+		std::vector<size_t> m_uses; // reads of each virtual register
+
+		size_t uses(VirtualRegister vr) const noexcept;
+		void use(VirtualRegister vr, int delta) noexcept;
+
+		static const std::vector<Rule> rules;
+	};
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include "data_type.h"
+#include "ir.h"
+
+namespace exprjit::ir
+{
+	// Linear scan allocation of Generator's virtual registers onto the target's register pools.
+	// Values that do not fit are kept in stack slots for their whole lifetime and moved through
+	// the scratch registers (I0/I1, F0/F1) around every instruction that accesses them.
+	// Values read inside a loop but defined before it keep their locations until its LoopEnd.
+	// Prepends an Enter instruction telling the target which pool registers and how many slots are used.
+	class RegisterAllocator {
+	public:
+		RegisterAllocator(std::vector<ir::Instruction>& ir, size_t integerRegisters, size_t floatRegisters) 
+			: m_ir(ir), m_integerRegisters(integerRegisters), m_floatRegisters(floatRegisters) { }
+
+		void operator()();
+
+	private:
+		struct Interval {
+			size_t start;
+			size_t end;
+			DataType type;
+			bool spilled;
+			size_t location; // pool register index or spill slot
+		};
+
+		std::vector<ir::Instruction>& m_ir;
+		size_t m_integerRegisters;
+		size_t m_floatRegisters;
+		std::vector<Interval> m_intervals; // by virtual register index
+		size_t m_slots;
+		uint64_t m_poolMask;
+
+		void buildIntervals();
+		void scan(DataType type, size_t registers);
+		void rewrite();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include "data_type.h"
+#include "ir.h"
+#include "binary_encoder.h"
+
+namespace exprjit::ir
+{
+	// List scheduler over the virtual register form. Reorders instructions within their register dependencies
+	// so independent chains overlap the target's latencies, longest remaining path first. While the values live
+	// would exceed a register pool, instructions that do not start new ones go first, not to cause spills.
+	// Stack instructions, loop boundaries, Precision and Ret keep their places. Runs before RegisterAllocator.
+	class Scheduler {
+	public:
+		Scheduler(std::vector<ir::Instruction>& ir, const BinaryEncoder& target) : m_ir(ir), m_target(target) { }
+
+		void operator()();
+
+	private:
+		struct Edge {
+			size_t to;
+			unsigned latency;
+		};
+
+		struct Node {
+			std::vector<Edge> successors;
+			size_t predecessors;	// not scheduled yet
+			unsigned latency;
+			unsigned height;		// latency of the longest path to the end
+			unsigned ready;			// cycle the operands are available in
+		};
+
+		std::vector<ir::Instruction>& m_ir;
+		const BinaryEncoder& m_target;
+		std::vector<Node> m_nodes;
+
+		void buildGraph();
+		void edge(size_t from, size_t to, unsigned latency);
+	};
+}
\ No newline at end of file
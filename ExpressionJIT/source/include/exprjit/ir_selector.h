@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include "ir.h"
+#include "ir_value_graph.h"
+#include "compile_options.h"
+
+namespace exprjit::ir
+{
+	// Instruction computing a value, possibly covering several nodes of the ValueGraph.
+	// It reads the values in operands, the first one in place when the code overwrites it,
+	// and carries the immediate after its register operands (zero when the code has none).
+	struct Tile {
+		constexpr static size_t Same = Value::None - 1; // second operand reads the register of the first
+
+		Code code;
+		size_t operands[2];
+		uint64_t immediate;
+		unsigned cost; // of the tile and the operands computed only for it
+	};
+
+	// Multi-node pattern. Match fills the tile for value v or returns false; nodes it covers
+	// besides v and literals must have no other uses, they are not computed on their own.
+	// Fast math patterns may change the rounding and are only tried with CompileOptions::fastMath.
+	struct Pattern {
+		const char* name;
+		unsigned cost;
+		bool fastMath;
+		bool (*match)(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile);
+	};
+
+	// Tiles a ValueGraph bottom-up with the cheapest matching patterns, so Generator may lower
+	// several nodes to one target instruction (lea, immediate and memory operand forms, rounding modes).
+	class Selector {
+	public:
+		static const std::vector<Pattern> patterns;
+
+		explicit Selector(const ValueGraph& graph, const CompileOptions& options = {});
+
+		const std::vector<Tile>& tiles() const noexcept { return m_tiles; }
+		// Reads of each value by the tiles reachable from root, the root counts as one more.
+		std::vector<size_t> useCounts(size_t root) const;
+
+	private:
+		std::vector<Tile> m_tiles;
+	};
+}
\ No newline at end of file
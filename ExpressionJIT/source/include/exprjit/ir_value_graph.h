@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include "data_type.h"
+#include "expression_node.h"
+#include "ir.h"
+
+namespace exprjit::ir
+{
+	// Node of a ValueGraph. Code is the typed instruction computing the value,
+	// operands refer to values defined earlier in the graph.
+	struct Value {
+		constexpr static size_t None = std::numeric_limits<size_t>::max();
+
+		Code code;			// ILoadR/FLoadR, IArgR/FArgR, IBlockR/FParamR, arithmetic, IToF/FToI, SToF/FToS
+		DataType type;
+		size_t operands[2];
+		uint64_t immediate;	// Literal bits, argument or parameter index
+
+		bool operator==(const Value&) const = default;
+	};
+
+	// SSA form of an expression: every value is defined once, before its uses, and structurally
+	// equal values get the same number, so repeated subexpressions are computed only once.
+	//
+	// Float values are all of one precision: Single when the arguments read and the result are Single or
+	// integers, with at least one Single among them, Float otherwise. Literals, parameters and conversions
+	// from integers take that precision, Single arguments and results of Float code are converted.
+	class ValueGraph {
+	public:
+		// Parameters are read through the address of the block, IBlockR shared by all of them.
+		ValueGraph(const std::vector<ExpressionNode>& expr, size_t root, DataType resultType);
+
+		const std::vector<Value>& values() const noexcept { return m_values; }
+		const Value& operator[](size_t i) const noexcept { return m_values[i]; }
+		size_t size() const noexcept { return m_values.size(); }
+		size_t root() const noexcept { return m_root; }
+		DataType precision() const noexcept { return m_precision; }
+
+		// Number of operand slots referring to each value, the root counts as one more use.
+		std::vector<size_t> useCounts() const;
+
+	private:
+		struct Hash {
+			size_t operator()(const Value&) const noexcept;
+		};
+
+		std::vector<Value> m_values;
+		std::unordered_map<Value, size_t, Hash> m_numbers;
+		size_t m_root;
+		DataType m_precision;
+
+		size_t number(Code code, DataType type, size_t a, size_t b = Value::None, uint64_t immediate = 0);
+		size_t build(const std::vector<ExpressionNode>& expr, size_t i);
+		size_t convert(size_t v, DataType type);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace exprjit
+{
+	// Placement of the elements of a caller-owned buffer: element i at offset + i * stride bytes,
+	// stride 0 packing them at the size of their type.
+	struct Layout {
+		uint32_t stride = 0;
+		uint32_t offset = 0;
+	};
+
+	// Of the argument columns of a batch kernel by argument index, arguments past the end being contiguous,
+	// and of its results. Records of several fields are columns of one base address at different offsets.
+	struct BatchLayout {
+		std::vector<Layout> arguments;
+		Layout result;
+	};
+
+	// Points a grid kernel evaluates, row by row: f(xmin + i * xstep, ymin + (row + j) * ystep) for i < nx, j < ny.
+	// Rows counting from row, a grid split into bands of rows evaluates the same points as the whole one.
+	// Kernels read it by address in this order, the field offsets are part of the code.
+	struct Grid {
+		double xmin, xstep;
+		double ymin, ystep;
+		int64_t nx, ny;
+		double row = 0;
+
+		bool operator==(const Grid&) const = default;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "function.h"
+#include "layout.h"
+#include "thread_pool.h"
+
+namespace exprjit
+{
+	// Bytes a chunk of a parallel evaluation reads and writes by default, about half of the L2 cache of a core.
+	constexpr size_t ChunkBytes = 1 << 17;
+	// Elements of a batch chunk are a multiple of this, whole iterations of the unrolled packed loops.
+	constexpr size_t ChunkGranule = 64;
+
+	// Evaluates f(args, out, n) on the threads of pool, chunk elements per task, 0 sizing chunks by ChunkBytes.
+	// layout is the one f was compiled for. Chunk boundaries depend on n, the layout and chunk only, not on the threads,
+	// so the same elements take the packed and the remainder loops and results do not change with the pool.
+	template<typename ReturnType, typename... ArgumentTypes>
+	void parallel(ThreadPool& pool, const BatchFunction<ReturnType(ArgumentTypes...)>& f, const void* const* args, ReturnType* out, size_t n,
+		const BatchLayout& layout = {}, size_t chunk = 0) {
+		constexpr size_t arity = sizeof...(ArgumentTypes);
+		std::array<size_t, arity + 1> strides { sizeof(ArgumentTypes)..., sizeof(ReturnType) };
+		for (size_t a = 0; a < arity && a < layout.arguments.size(); ++a) {
+			if (layout.arguments[a].stride != 0) strides[a] = layout.arguments[a].stride;
+		}
+		if (layout.result.stride != 0) strides[arity] = layout.result.stride;
+		if (chunk == 0) {
+			size_t bytes = 0;
+			for (size_t stride : strides) bytes += stride;
+			chunk = std::max(ChunkBytes / bytes / ChunkGranule, size_t(1)) * ChunkGranule;
+		}
+
+		pool.run(( n + chunk - 1 ) / chunk, [&](size_t c) {
+			size_t begin = c * chunk;
+			std::array<const void*, arity + 1> columns {};
+			for (size_t a = 0; a < arity; ++a) columns[a] = (const unsigned char*)args[a] + begin * strides[a];
+			f(columns.data(), (ReturnType*)( (unsigned char*)out + begin * strides[arity] ), std::min(chunk, n - begin));
+		});
+	}
+
+	template<typename ReturnType, typename... ArgumentTypes>
+	void parallel(ThreadPool& pool, const BatchFunction<ReturnType(ArgumentTypes...)>& f, ReturnType* out, size_t n, const ArgumentTypes*... args) {
+		const void* columns[] { args..., nullptr };
+		parallel(pool, f, columns, out, n);
+	}
+
+	// Evaluates f(grid, out) on the threads of pool in bands of rows rows, 0 sizing them by ChunkBytes.
+	// layout is the one f was compiled for. Every band evaluates the points of the whole grid it covers.
+	template<typename ReturnType>
+	void parallel(ThreadPool& pool, const GridFunction<ReturnType>& f, const Grid& grid, void* out, const Layout& layout = {}, size_t rows = 0) {
+		if (grid.nx <= 0 || grid.ny <= 0) return;
+		size_t ny = (size_t)grid.ny, rowBytes = (size_t)grid.nx * ( layout.stride != 0 ? layout.stride : sizeof(ReturnType) );
+		if (rows == 0) rows = std::max(ChunkBytes / rowBytes, size_t(1));
+
+		pool.run(( ny + rows - 1 ) / rows, [&](size_t c) {
+			Grid band = grid;
+			band.row += (double)( c * rows );
+			band.ny = (int64_t)std::min(rows, ny - c * rows);
+			f(band, (unsigned char*)out + c * rows * rowBytes);
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include "expression_node.h"
+
+namespace exprjit
+{
+	// Named float values that compiled code reads on every evaluation, $name in expressions.
+	// A value set takes effect from the next evaluation without recompiling, from any thread, without locks.
+	// Functions pass the address of the block to the code as its last argument: the block must outlive
+	// the functions reading it, and its capacity is fixed. The code itself does not depend on the block.
+	class ParameterBlock {
+	public:
+		using Value = std::atomic<double>;
+		static_assert(sizeof(Value) == sizeof(double) && Value::is_always_lock_free);
+
+		explicit ParameterBlock(size_t capacity = 64);
+
+		// Index of the named parameter, added with value 0 if new. Throws std::length_error when the block is full.
+		unsigned index(std::string_view name);
+		std::optional<unsigned> find(std::string_view name) const noexcept;
+
+		double get(unsigned index) const noexcept { return m_values[index].load(std::memory_order_relaxed); }
+		void set(unsigned index, double value) noexcept { m_values[index].store(value, std::memory_order_relaxed); }
+
+		size_t size() const noexcept { return m_names.size(); }
+		const std::string& name(unsigned index) const noexcept { return m_names[index]; }
+		// Address of the values, index * 8 bytes apart.
+		const Value* data() const noexcept { return m_values.get(); }
+
+		ParameterBlock(const ParameterBlock&) = delete;
+		ParameterBlock& operator=(const ParameterBlock&) = delete;
+
+	private:
+		std::unique_ptr<Value[]> m_values;
+		size_t m_capacity;
+		std::vector<std::string> m_names;
+	};
+
+	// Whether the expression reads parameters. Its code then takes the address of the block as one more integer
+	// argument, after the declared ones, and IBlockR reads it from there.
+	bool readsParameters(const std::vector<ExpressionNode>& expr, size_t root);
+}
\ No newline at end of file
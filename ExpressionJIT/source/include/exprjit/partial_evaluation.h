@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "expression_node.h"
+
+namespace exprjit
+{
+	// Argument fixed to a value, in the bits of a literal of the argument's DataType (see ExpressionNode).
+	struct ArgumentBinding {
+		unsigned index;
+		uint64_t value;
+	};
+
+	// Partial evaluation: the bound arguments of the tree become typed literals of their types, keeping the precision
+	// of the kernel (see floatPrecision), the others are renumbered
+	// in their order, so the expression only takes the unbound ones. Simplifier then folds the subtrees depending
+	// on bound arguments alone (sin/cos included), and divisors that became literals get the immediate forms.
+	void bindArguments(std::vector<ExpressionNode>& expr, const std::vector<ArgumentBinding>& bindings);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "expression_node.h"
+#include "compile_options.h"
+
+namespace exprjit
+{
+	// Folds constant subtrees and removes operations that cannot change the result under IEEE rules
+	// (x * 1, x / 1, x - 0, - -x, ...; x + 0 and x * 0 only for integers). Follows the typing of
+	// ir::Generator: integer operands of float operations become float literals, FToI rounds to nearest,
+	// and float operations are folded at the precision of the whole kernel (floatPrecision of resultType).
+	// With CompileOptions::fastMath float chains are also reassociated and the IEEE exceptions above dropped.
+	// New nodes are appended to the tree, returns the new root.
+	class Simplifier {
+	public:
+		Simplifier(std::vector<ExpressionNode>& expr, size_t root, DataType resultType, const CompileOptions& options = {})
+			: m_expr(expr), m_root(root), m_options(options), m_precision(floatPrecision(expr, root, resultType)) { }
+
+		size_t operator()();
+
+	private:
+		struct Result {
+			size_t node;
+			DataType type;
+			bool constant;
+			uint64_t value;
+		};
+
+		std::vector<ExpressionNode>& m_expr;
+		size_t m_root;
+		CompileOptions m_options;
+		DataType m_precision; // of every float value
+		std::unordered_map<size_t, Result> m_results;
+		std::unordered_map<size_t, DataType> m_types;
+
+		Result simplify(size_t i);
+		Result simplifyBinop(size_t i, ExpressionNode::Binop op, Result lhs, Result rhs);
+		Result simplifyUnop(size_t i, ExpressionNode::Unop op, Result operand);
+		Result reassociate(size_t i);
+		Result balance(std::vector<Result> terms, ExpressionNode::Binop op);
+		DataType typeOf(size_t i);
+		Result convert(Result r, DataType type);
+		Result literal(uint64_t value, DataType type);
+		Result node(ExpressionNode node, DataType type);
+	};
+}
\ No newline at end of file
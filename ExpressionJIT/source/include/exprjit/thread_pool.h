@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+namespace exprjit
+{
+	// Workers running the tasks of one job at a time, the thread calling run taking part as well.
+	// Tasks are split into equal contiguous ranges, one per thread; a thread out of tasks steals
+	// the upper half of the range of another one, so uneven tasks still keep all of them busy.
+	class ThreadPool {
+	public:
+		struct Options {
+			size_t threads = 0; // including the caller, 0 for one per hardware thread
+			bool pin = false; // binds worker i to logical processor i, the caller is left as it is
+		};
+
+		ThreadPool();
+		explicit ThreadPool(const Options& options);
+		~ThreadPool();
+
+		// Threads the tasks run on, the caller included.
+		size_t size() const noexcept { return m_ranges.size(); }
+
+		// Calls task(i) for every i < count (below 2^32) and returns when all calls have. Tasks must not throw,
+		// run must not be called from one of them, concurrent calls from other threads run one after another.
+		void run(size_t count, const std::function<void(size_t)>& task);
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+	private:
+		// Tasks [begin, end) left to a thread as begin | end << 32, taken from the front by the owner
+		// and from the back by thieves.
+		struct alignas(64) Range {
+			std::atomic<uint64_t> bounds { 0 };
+		};
+
+		std::vector<Range> m_ranges; // by thread, the caller's first
+		std::vector<std::thread> m_workers;
+		std::mutex m_runMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		const std::function<void(size_t)>* m_task = nullptr;
+		uint64_t m_generation = 0;
+		size_t m_busy = 0; // workers still in the current job
+		bool m_stop = false;
+		bool m_pin;
+
+		void worker(size_t thread);
+		void work(size_t thread);
+		bool take(size_t thread, size_t& task) noexcept;
+		bool steal(size_t thread, size_t victim) noexcept;
+		static void pin(size_t thread) noexcept;
+	};
+}
\ No newline at end of file
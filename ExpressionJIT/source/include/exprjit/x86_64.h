@@ -1,811 +1,2312 @@
-#pragma once
-#include <exception>
-#include <unordered_map>
-#include <numbers>
-#include <functional>
-#include "binary_encoder.h"
-
-namespace exprjit
-{
-	//todo: unops and regextbit - unused? wrong? wtf
-
-	template<typename T>
-	concept Arithmetic = std::floating_point<T> || std::integral<T>;
-
-	class X86_64 : public BinaryEncoder {
-	public:
-		X86_64(binary_t bin, size_t integerArgs, size_t floatArgs) : BinaryEncoder(bin, integerArgs, floatArgs) { }
-
-	private:
-#pragma region Registers
-		constexpr static uint32_t RAX = 0b000;
-		constexpr static uint32_t RCX = 0b001;
-		constexpr static uint32_t RDX = 0b010;
-		constexpr static uint32_t RBX = 0b011;
-		constexpr static uint32_t RSP = 0b100;
-		constexpr static uint32_t RBP = 0b101;
-		constexpr static uint32_t RSI = 0b110;
-		constexpr static uint32_t RDI = 0b111;
-
-		constexpr static uint32_t R8 = 0b1000;
-		constexpr static uint32_t R9 = 0b1001;
-		constexpr static uint32_t R10 = 0b1010;
-		constexpr static uint32_t R11 = 0b1011;
-		constexpr static uint32_t R12 = 0b1100;
-		constexpr static uint32_t R13 = 0b1101;
-		constexpr static uint32_t R14 = 0b1110;
-		constexpr static uint32_t R15 = 0b1111;
-
-		constexpr static uint32_t XMM0 = 0b000;
-		constexpr static uint32_t XMM1 = 0b001;
-		constexpr static uint32_t XMM2 = 0b010;
-		constexpr static uint32_t XMM3 = 0b011;
-		constexpr static uint32_t XMM4 = 0b100;
-		constexpr static uint32_t XMM5 = 0b101;
-		constexpr static uint32_t XMM6 = 0b110;
-		constexpr static uint32_t XMM7 = 0b111;
-
-		constexpr static uint32_t reg_ext = 0b1000;
-		constexpr static uint32_t reg_mask = 0b111;
-		constexpr static uint32_t reg_argi[4] { RCX, RDX, R8, R9 };
-		constexpr static uint32_t reg_argf[4] { XMM0, XMM1, XMM2, XMM3 };
-#pragma endregion
-#pragma region REX
-		constexpr static uint32_t m_rex_base = 0b01000000;
-		constexpr static uint32_t m_rex_w = 0b1000;
-		constexpr static uint32_t m_rex_r = 0b0100; //ext REG
-		constexpr static uint32_t m_rex_x = 0b0010;
-		constexpr static uint32_t m_rex_b = 0b0001; //ext R/M
-
-		constexpr static uint32_t rexw(uint32_t reg, uint32_t rm) {
-			return m_rex_base | m_rex_w | ( reg & reg_ext ? m_rex_r : 0 ) | ( rm & reg_ext ? m_rex_b : 0 );
-		}
-#pragma endregion
-#pragma region Opcodes
-		class BadOpcodeException : public std::exception {
-			const char* what() const noexcept override {
-				return "Bad opcode.";
-			}
-		};
-
-		enum class RegExtBit {
-			B, R
-		};
-
-		class Prefix {
-		public:
-			constexpr static uint32_t None = 0;
-			constexpr static uint32_t REX = 1 << 0;
-			constexpr static uint32_t REXF = 1 << 1;
-			constexpr static uint32_t x66 = 1 << 2;
-			constexpr static uint32_t xF2 = 1 << 3;
-
-			constexpr Prefix(uint32_t v) : m_value(v) { }
-
-			constexpr bool has(uint32_t v) const {
-				return m_value & v;
-			}
-			constexpr bool has(Prefix r) const {
-				return m_value & r.m_value;
-			}
-
-		private:
-			uint32_t m_value;
-		};
-
-		struct Instruction {
-			enum class Type {
-				Vop,		// No args
-				Binop,	// /r
-				Digop,	// /digit
-				Unop		// +r*
-			};
-
-			static Instruction vop(X86_64& emitter, Opcode code) {
-				return Instruction(emitter, code, Type::Vop, Prefix::None);
-			}
-			static Instruction unop(X86_64& emitter, Opcode code, Prefix prefix, RegExtBit rext) {
-				return Instruction(emitter, code, Type::Unop, prefix, rext);
-			}
-			static Instruction binop(X86_64& emitter, Opcode code, Prefix prefix) {
-				return Instruction(emitter, code, Type::Binop, prefix);
-			}
-			static Instruction digop(X86_64& emitter, Opcode code, Prefix prefix, uint32_t digit) {
-				auto op = Instruction(emitter, code, Type::Digop, prefix);
-				op.m_digit = digit;
-				return op;
-			}
-
-			void operator()() {
-#ifndef NDEBUG
-				if (m_type != Type::Vop) [[unlikely]] {
-					throw BadOpcodeException();
-				}
-#endif 
-				m_emitter.emit(m_code);
-			}
-			void operator()(uint32_t reg, uint32_t rm) {
-#ifndef NDEBUG
-				if (m_type != Type::Binop) [[unlikely]] {
-					throw BadOpcodeException();
-				}
-#endif
-				if (m_prefix.has(Prefix::x66)) m_emitter.emit(0x66ui8);
-				else if (m_prefix.has(Prefix::xF2)) m_emitter.emit(0xF2ui8);
-
-				if (m_prefix.has(Prefix::REXF) || (m_prefix.has(Prefix::REX) && ( reg & reg_ext || rm & reg_ext ) ))
-					m_emitter.emit(rexw(reg, rm));
-
-				m_emitter.emit(
-					m_code,
-					modrm_rr(reg, rm)
-				);
-			}
-			void operator()(uint32_t r) {
-				switch (m_type) {
-					case Type::Unop:
-						if (m_prefix.has(Prefix::x66)) m_emitter.emit(0x66ui8);
-						else if (m_prefix.has(Prefix::xF2)) m_emitter.emit(0xF2ui8);
-
-						if (m_prefix.has(Prefix::REXF) || ( m_prefix.has(Prefix::REX) && r & reg_ext )) {
-							m_emitter.emit(
-								m_rex_base | m_rex_w | ( r & reg_ext ? (m_rext == RegExtBit::B ? m_rex_b : m_rex_r) : 0 )
-							);
-						}
-						m_emitter.emit(m_code | ( r & reg_mask ));
-						break;
-					case Type::Digop:
-						if (m_prefix.has(Prefix::x66)) m_emitter.emit(0x66ui8);
-						else if (m_prefix.has(Prefix::xF2)) m_emitter.emit(0xF2ui8);
-
-						if (m_prefix.has(Prefix::REXF) || ( m_prefix.has(Prefix::REX) && r & reg_ext )) {
-							m_emitter.emit(m_rex_base | m_rex_w | ( r & reg_ext ? ( m_rext == RegExtBit::B ? m_rex_b : m_rex_r ) : 0 ));
-						}
-						m_emitter.emit(
-							m_code,
-							modrm_rr(m_digit, r)
-						);
-						break;
-#ifndef NDEBUG
-					[[unlikely]] default:
-						throw BadOpcodeException();
-#endif
-				}
-			}
-
-		private:
-			static unsigned char modrm_rr(uint32_t reg, uint32_t rm) noexcept {
-				return (unsigned char)(
-					( 0b11u << 6u ) |
-					( ( reg & reg_mask ) << 3 ) |
-					( ( rm & reg_mask ) )
-					);
-			}
-
-			X86_64& m_emitter;
-			Type m_type;
-			uint32_t m_digit;
-			Opcode m_code;
-			Prefix m_prefix;
-			RegExtBit m_rext;
-
-			Instruction(X86_64& emitter, const Opcode& code, Type type, Prefix prefix, RegExtBit rext = RegExtBit::B) noexcept
-				: m_type(type), m_emitter(emitter), m_code(code), m_prefix(prefix), m_digit(), m_rext(rext) { }
-		};
-
-		Instruction op_ret		= Instruction::vop(*this, { 0xC3 });
-
-		Instruction op_movvi		= Instruction::unop(*this,	{ 0xB8			}, Prefix::REXF,		RegExtBit::B	);//[REG = IMM		]
-		Instruction op_popi		= Instruction::unop(*this,	{ 0x58			}, Prefix::REX,		RegExtBit::B	);
-		Instruction op_pushi		= Instruction::unop(*this,	{ 0x50			}, Prefix::REX,		RegExtBit::B	);
-		Instruction op_movri		= Instruction::binop(*this,	{ 0x8B			}, Prefix::REXF					);//[REG = RM		]
-		Instruction op_addri		= Instruction::binop(*this,	{ 0x03			}, Prefix::REXF					);//[REG = REG + R/M	]
-		Instruction op_subri		= Instruction::binop(*this,	{ 0x2B			}, Prefix::REXF					);//[REG = REG - R/M]
-		Instruction op_subvi 	= Instruction::digop(*this,	{ 0x81			}, Prefix::REXF,		5			);//[R/M = R/M - V32]
-		Instruction op_mulri		= Instruction::binop(*this,	{ 0x0F, 0xAF		}, Prefix::REXF					);//[REG = REG * R/M	]
-		Instruction op_xorri		= Instruction::binop(*this,	{ 0x33			}, Prefix::REXF					);//[REG = REG ^ R/M	]
-		Instruction op_divri		= Instruction::digop(*this,	{ 0xF7			}, Prefix::REXF,		7			);
-		Instruction op_negri		= Instruction::digop(*this,	{ 0xF7			}, Prefix::REXF,		3			);//[RM = -RM		]
-		Instruction op_sarvi		= Instruction::digop(*this,	{ 0xC1			}, Prefix::REXF,		7			);//[RM = RM >>>	 i8 ]
-		
-
-		Instruction op_loadf		= Instruction::binop(*this, { 0x0F, 0x6E			}, Prefix::x66 | Prefix::REXF);	// [XMM = R/M]
-		Instruction op_storef	= Instruction::binop(*this, { 0x0F, 0x7E			}, Prefix::x66 | Prefix::REXF); // [R/M = XMM]
-		Instruction op_movf		= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::xF2);
-		Instruction op_addf		= Instruction::binop(*this, { 0x0F, 0x58			}, Prefix::xF2);
-		Instruction op_subf		= Instruction::binop(*this, { 0x0F, 0x5C			}, Prefix::xF2);
-		Instruction op_mulf		= Instruction::binop(*this, { 0x0F, 0x59			}, Prefix::xF2);
-		Instruction op_divf		= Instruction::binop(*this, { 0x0F, 0x5E			}, Prefix::xF2);
-		Instruction op_xorf		= Instruction::binop(*this, { 0x0F, 0x57			}, Prefix::x66); // [REG = REG ^ R/M]
-		Instruction op_andf		= Instruction::binop(*this, { 0x0F, 0x54			}, Prefix::x66); // [REG = REG & R/M]
-		Instruction op_roundf	= Instruction::binop(*this, { 0x0F, 0x3A, 0x0B	}, Prefix::x66); // [REG = round R/M] [i8]
-
-		Instruction op_pcmpeqw	= Instruction::binop(*this, { 0x0F, 0x75			}, Prefix::x66);
-		Instruction op_psllqv	= Instruction::digop(*this, { 0x0F, 0x73			}, Prefix::x66,		6); // ... [i8]
-		Instruction op_psrlqv	= Instruction::digop(*this, { 0x0F, 0x73			}, Prefix::x66,		2); // ... [i8]
-
-		Instruction op_ftoi		= Instruction::binop(*this, { 0x0F, 0x2D }, Prefix::xF2 | Prefix::REXF); // [REG = (I) R/M]
-		Instruction op_itof		= Instruction::binop(*this, { 0x0F, 0x2A }, Prefix::xF2 | Prefix::REXF); // [R/M = (D) REG]
-
-#pragma endregion
-		
-		//uint64_t getBin(double v) {
-		//	union {
-		//		double vd;
-		//		uint64_t vi;
-		//	};
-		//	vd = v;
-		//	return vi;
-		//}
-
-		template<Arithmetic T >
-		void value(T value) {
-			union {
-				T vi;
-				unsigned char vc[sizeof(T)];
-			};
-			vi = value;
-			for (size_t i = 0; i < sizeof(T); ++i) {
-				emit(vc[i]);
-			}
-		}
-
-		void pushf(uint32_t reg) {
-			op_storef(reg, R11);
-			op_pushi(R11);
-		}
-		void popf(uint32_t reg) {
-			op_popi(R11);
-			op_loadf(reg, R11);
-		}
-		void negf(uint32_t reg, uint32_t tmp) {
-			op_movvi(R11);
-			value<uint64_t>(0x8000000000000000);
-			op_loadf(tmp, R11);
-			op_xorf(reg, tmp);
-		}
-		void genf1(uint32_t reg) {
-			op_pcmpeqw(reg, reg);
-			op_psllqv(reg);
-			value<uint8_t>(54ui8);
-			op_psrlqv(reg);
-			value<uint8_t>(2ui8);
-		}
-		void loadfv(uint32_t reg, double v) {
-			op_movvi(R11);
-			value<double>(v);
-			op_loadf(reg, R11);
-		}
-
-		inline static std::unordered_map<ir::VirtualRegister, uint32_t> regMap {
-			{ ir::VirtualRegister::I0, RAX	},
-			{ ir::VirtualRegister::I1, R10	},
-			{ ir::VirtualRegister::IR, RAX  },
-			{ ir::VirtualRegister::F0, XMM4	},
-			{ ir::VirtualRegister::F1, XMM5	},
-			{ ir::VirtualRegister::FR, XMM0 }
-		};
-
-		std::unordered_map<ir::Code, std::function<void(const ir::Instruction&)>> emitterMap {
-			{
-				ir::Code::Ret,
-				[this](const ir::Instruction&){
-					op_ret(); 
-				}
-			},
-			{
-				ir::Code::ILoadR,
-				[this](const ir::Instruction& i) {
-					auto r = regMap.at(i.operands[0].reg);
-					op_movvi(r);
-					value<int64_t>(i.operands[1].value);
-					op_pushi(r);
-				}
-			},
-			{
-				ir::Code::ILoad,
-				[this](const ir::Instruction& i) {
-					op_movvi(RAX);
-					value<int64_t>(i.operands[0].value);
-					op_pushi(RAX);
-				}
-			},
-			{
-				ir::Code::IArg,
-				[this](const ir::Instruction& i) {
-					op_pushi(reg_argi[i.operands[0].value]);
-				}
-			},
-			{
-				ir::Code::IPush,
-				[this](const ir::Instruction& i) {
-					op_pushi(regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::IPop,
-				[this](const ir::Instruction& i) {
-					op_popi(regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::IMov,
-				[this](const ir::Instruction& i) {
-					op_movri(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::IAdd,
-				[this](const ir::Instruction& i) {
-					op_addri(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::ISub,
-				[this](const ir::Instruction& i) {
-					op_subri(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::IMul,
-				[this](const ir::Instruction& i) {
-					op_mulri(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::IDiv,
-				[this](const ir::Instruction& i) {
-					uint32_t r0 = regMap.at(i.operands[0].reg), r1 = regMap.at(i.operands[1].reg);
-					op_movri(RAX, r0);
-					op_movri(R11, RDX);
-					op_xorri(RDX, RDX);
-					op_divri(r1);
-					op_movri(r0, RAX);
-					op_movri(RDX, R11);
-				}
-			},
-			{
-				ir::Code::IMod,
-				[this](const ir::Instruction& i) {
-					uint32_t r0 = regMap.at(i.operands[0].reg), r1 = regMap.at(i.operands[1].reg);
-					op_movri(RAX, r0);
-					op_movri(R11, RDX);
-					op_xorri(RDX, RDX);
-					op_divri(r1);
-					op_movri(r0, RDX);
-					op_movri(RDX, R11);
-				}
-			},
-			{
-				ir::Code::INeg,
-				[this](const ir::Instruction& i) {
-					op_negri(regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::IAbs,
-				[this](const ir::Instruction& i) {
-					uint32_t r0 = regMap.at(i.operands[0].reg);
-					uint32_t r1 = r0 == RAX ? R10 : RAX;
-					op_movri(r1, r0);
-					op_sarvi(r1);
-					value<uint8_t>(63);
-					op_xorri(r0, r1);
-					op_subri(r0, r1);
-				}
-			},
-
-			{
-				ir::Code::FLoad,
-				[this](const ir::Instruction& i) {
-					op_movvi(RAX);
-					value<uint64_t>(i.operands[0].value);
-					op_pushi(RAX);
-				}
-			},
-			{
-				ir::Code::FArg,
-				[this](const ir::Instruction& i) {
-					pushf(reg_argf[i.operands[0].value]);
-				}
-			},
-			{
-				ir::Code::FPush,
-				[this](const ir::Instruction& i) {
-					pushf(regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::FPop,
-				[this](const ir::Instruction& i) {
-					popf(regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::FMov,
-				[this](const ir::Instruction& i) {
-					op_movf(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::FAdd,
-				[this](const ir::Instruction& i) {
-					op_addf(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::FSub,
-				[this](const ir::Instruction& i) {
-					op_subf(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::FMul,
-				[this](const ir::Instruction& i) {
-					op_mulf(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::FDiv,
-				[this](const ir::Instruction& i) {
-					op_divf(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			},
-			{
-				ir::Code::FNeg,
-				[this](const ir::Instruction& i) {
-
-
-					uint32_t xra = regMap.at(i.operands[0].reg);
-					uint32_t xrt = xra == XMM4 ? XMM5 : XMM4;
-					negf(xra, xrt);
-				}
-			},
-			{
-				ir::Code::FAbs,
-				[this](const ir::Instruction& i) {
-					op_movvi(RAX);
-					value<uint64_t>(0x7fffffffffffffff);
-					uint32_t xra = regMap.at(i.operands[0].reg);
-					uint32_t xrt = xra == XMM4 ? XMM5 : XMM4;
-					op_loadf(xrt, RAX);
-					op_andf(xra, xrt);
-				}
-			},
-			{
-				ir::Code::FFloor,
-				[this](const ir::Instruction& i) {
-					uint32_t xra = regMap.at(i.operands[0].reg);
-					op_roundf(xra, xra);
-					value<uint8_t>(9ui8);
-				}
-			},
-			{
-				ir::Code::FSin,
-				[this](const ir::Instruction& i) {
-					//Taylor series, n = 10
-					//XRA - sum, result
-					//XRT = x^(i * 2 + 1), computed by multiplying by XMM2
-					//XMM1 - addend, initially = x^(i * 2 + 1), divided by XMM3 and added to/subtracted from XRA 
-					//XMM2 - x^2
-					//XMM3 - divider, = (i * 2 + 1)!
-					//XMM0 - used in argument reduction st2
-
-					
-					uint32_t xra = regMap.at(i.operands[0].reg);
-					uint32_t xrt = xra == XMM4 ? XMM5 : XMM4;
-					if (m_floatArguments > 0) {
-						pushf(XMM0);
-						if (m_floatArguments > 1) {
-							pushf(XMM1);
-							if (m_floatArguments > 2) {
-								pushf(XMM2);
-								if (m_floatArguments > 3) {
-									pushf(XMM3);
-								}
-							}
-						}
-					}
-
-					//argument reduction to [0; 2pi]				x' = x - 2pi * floor(x / 2pi);
-					op_movf(xrt, xra);							// xra = x
-					op_movvi(RAX);								// load 2pi to XMM2
-					value<double>(2.0 * std::numbers::pi);		// ^
-					op_loadf(XMM2, RAX);							// ^
-					op_divf(xrt, XMM2);							// xrt = x / 2pi
-					op_roundf(xrt, xrt);							// xrt = floor(xrt)
-					value<uint8_t>(9ui8);						// ^ (rounding mode)
-					op_mulf(xrt, XMM2);							// xrt = xrt (floor( x / 2pi)) * XMM2 (2pi)
-					op_subf(xra, xrt);							// xra = xra - xrt <=> x' = x - floor(x / 2pi) 
-
-					//argument reduction to [0; pi]			
-					// [ sin (pi + x) = -sin x ]
-					// XMM0 = -floor(x' / pi), x'' = x' + XMM0 * pi
-					// result = (XMM0 * 2 + 1) * result  (XMM0 * 2 + 1 maps {-1, 0} to {-1, 1})
-					// eq: x' > pi ? -f(x' - pi) : f(x') 
-					op_movf(XMM0, xra);							// XMM0 = x'
-					op_movvi(RAX);								// load pi to xrt
-					value<double>(std::numbers::pi);				// ^
-					op_loadf(xrt, RAX);							// ^
-					op_divf(XMM0, xrt);							// XMM0 = = XMM0 / pi (= x' / pi)
-					op_roundf(XMM0, XMM0);						// XMM0 = floor(XMM0)
-					value<uint8_t>(9ui8);						// ^ (rounding mode)
-					negf(XMM0, XMM1);							// XMM0 = -XMM0	(XMM1 is tmp reg to store sign mask)
-					op_movf(XMM1, XMM0);							// XMM1 = XMM0
-					op_mulf(XMM1, xrt);							// XMM1 = XMM1 * pi ( = XMM0 * pi)
-					op_addf(xra, XMM1);							// xra = xra + XMM1 (x'' = x' + XMM0 * pi)
-
-					//1, 2
-					op_movf(xrt, xra);
-					op_mulf(xrt, xrt);
-					op_movf(XMM2, xrt);
-					op_mulf(xrt, xra);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(6.0);	// 3!
-					//value<uint64_t>(getBin(6.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					//3
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(120.0); // 5!
-					//value<uint64_t>(getBin(120.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_addf(xra, XMM1);
-
-					//4
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(5040.0); // 7!
-					//value<uint64_t>(getBin(5040.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					//5
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(362880.0); // 9!
-					//value<uint64_t>(getBin(362880.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_addf(xra, XMM1);
-
-					//6
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(39916800.0); // 11!
-					//value<uint64_t>(getBin(39916800.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					//7
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(6227020800.0); // 13!
-					//value<uint64_t>(getBin(6227020800.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_addf(xra, XMM1);
-
-					//8
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(1307674368000.0); // 15!
-					//value<uint64_t>(getBin(1307674368000.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					//9
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(355687428096000.0); // 17!
-					//value<uint64_t>(getBin(1307674368000.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_addf(xra, XMM1);
-
-					//10
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					op_movvi(RAX);
-					value<double>(121645100408832000.0); // 19!
-					//value<uint64_t>(getBin(1307674368000.0));
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					op_addf(XMM0, XMM0);		//XMM0 *= 2
-					genf1(XMM1);				//XMM1 = 1
-					op_addf(XMM0, XMM1);		//XMM0 += 1
-					op_mulf(xra, XMM0);
-
-					if(m_floatArguments > 0) { 
-						if (m_floatArguments > 1) {
-							if (m_floatArguments > 2) {
-								if (m_floatArguments > 3) {
-									popf(XMM3);
-								}
-								popf(XMM2);
-							}
-							popf(XMM1);
-						}
-						popf(XMM0);
-					}
-				}
-			},
-			{
-				ir::Code::FCos,
-				[this](const ir::Instruction& i) {
-					//Taylor series, n = 10
-					//XRA - sum, result
-					//XRT = x^(i * 2), computed by multiplying by XMM2
-					//XMM1 - addend, initially = x^(i * 2), divided by XMM3 and added to/subtracted from XRA 
-					//XMM2 - x^2
-					//XMM3 - divider, = (i * 2)!
-					//XMM0 - used in argument reduction st2
-
-
-					uint32_t xra = regMap.at(i.operands[0].reg);
-					uint32_t xrt = xra == XMM4 ? XMM5 : XMM4;
-					if (m_floatArguments > 0) {
-						pushf(XMM0);
-						if (m_floatArguments > 1) {
-							pushf(XMM1);
-							if (m_floatArguments > 2) {
-								pushf(XMM2);
-								if (m_floatArguments > 3) {
-									pushf(XMM3);
-								}
-							}
-						}
-					}
-
-					//argument reduction to [0; 2pi]				x' = x - 2pi * floor(x / 2pi);
-					op_movf(xrt, xra);							// xra = x
-					op_movvi(RAX);								// load 2pi to XMM2
-					value<double>(2.0 * std::numbers::pi);		// ^
-					op_loadf(XMM2, RAX);							// ^
-					op_divf(xrt, XMM2);							// xrt = x / 2pi
-					op_roundf(xrt, xrt);							// xrt = floor(xrt)
-					value<uint8_t>(9ui8);						// ^ (rounding mode)
-					op_mulf(xrt, XMM2);							// xrt = xrt (floor( x / 2pi)) * XMM2 (2pi)
-					op_subf(xra, xrt);							// xra = xra - xrt <=> x' = x - floor(x / 2pi) 
-
-					//argument reduction to [0; pi]			
-					// [ cos (pi + x) = -cos x ]
-					// XMM0 = -floor(x' / pi), x'' = x' + XMM0 * pi
-					// result = (XMM0 * 2 + 1) * result  (XMM0 * 2 + 1 maps {-1, 0} to {-1, 1})
-					// eq: x' > pi ? -f(x' - pi) : f(x') 
-					op_movf(XMM0, xra);							// XMM0 = x'
-					op_movvi(RAX);								// load pi to xrt
-					value<double>(std::numbers::pi);				// ^
-					op_loadf(xrt, RAX);							// ^
-					op_divf(XMM0, xrt);							// XMM0 = = XMM0 / pi (= x' / pi)
-					op_roundf(XMM0, XMM0);						// XMM0 = floor(XMM0)
-					value<uint8_t>(9ui8);						// ^ (rounding mode)
-					negf(XMM0, XMM1);							// XMM0 = -XMM0	(XMM1 is tmp reg to store sign mask)
-					op_movf(XMM1, XMM0);							// XMM1 = XMM0
-					op_mulf(XMM1, xrt);							// XMM1 = XMM1 * pi ( = XMM0 * pi)
-					op_addf(xra, XMM1);							// xra = xra + XMM1 (x'' = x' + XMM0 * pi)
-
-					//1, 2
-					op_movf(xrt, xra);		// xrt = x''
-					genf1(xra);				// xra = 1
-					op_mulf(xrt, xrt);		// xrt = x''^2
-					op_movf(XMM2, xrt);		// xmm2 = x''^2
-					op_movf(XMM1, xrt);		// xmm1 = x''^2
-					op_movvi(RAX);
-					value<double>(2.0);
-					op_loadf(XMM3, RAX);
-					op_divf(XMM1, XMM3);		// xmm1 = x''^2 / 2!
-					op_subf(xra, XMM1);		// xra = 1 - x''^2 / 2!
-
-					//3
-					op_mulf(xrt, XMM2);		//xrt = x''^2 * x''^2 = x''^4
-					op_movf(XMM1, xrt);		//xmm1 = xrt
-					loadfv(XMM3, 24.0);		//xmm3 = 4!
-					op_divf(XMM1, XMM3);		//xmm1 = xmm1 / xmm3 = xrt / 4! = x''^4 / 4!
-					op_addf(xra, XMM1);
-
-					//4
-					op_mulf(xrt, XMM2);		
-					op_movf(XMM1, xrt);	
-					loadfv(XMM3, 720.0);	
-					op_divf(XMM1, XMM3);		
-					op_subf(xra, XMM1);
-
-					//5
-					op_mulf(xrt, XMM2);		
-					op_movf(XMM1, xrt);		
-					loadfv(XMM3, 40320.0);		
-					op_divf(XMM1, XMM3);	
-					op_addf(xra, XMM1);
-
-					//6
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					loadfv(XMM3, 3628800.0);
-					op_divf(XMM1, XMM3);		
-					op_subf(xra, XMM1);
-
-					//7
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					loadfv(XMM3, 479001600.0);
-					op_divf(XMM1, XMM3);	
-					op_addf(xra, XMM1);
-
-					//8
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					loadfv(XMM3, 87178291200.0); // 14!
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					//9
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					loadfv(XMM3, 20922789888000.0);  // 16!
-					op_divf(XMM1, XMM3);
-					op_addf(xra, XMM1);
-
-					//10
-					op_mulf(xrt, XMM2);
-					op_movf(XMM1, xrt);
-					loadfv(XMM3, 6402373705728000.0); // 18!
-					op_divf(XMM1, XMM3);
-					op_subf(xra, XMM1);
-
-					op_addf(XMM0, XMM0);		//XMM0 *= 2
-					genf1(XMM1);				//XMM1 = 1
-					op_addf(XMM0, XMM1);		//XMM0 += 1
-					op_mulf(xra, XMM0);
-
-					if (m_floatArguments > 0) {
-						if (m_floatArguments > 1) {
-							if (m_floatArguments > 2) {
-								if (m_floatArguments > 3) {
-									popf(XMM3);
-								}
-								popf(XMM2);
-							}
-							popf(XMM1);
-						}
-						popf(XMM0);
-					}
-				}
-			},
-			{
-				ir::Code::FToI,
-				[this](const ir::Instruction& i) {
-					op_ftoi(regMap.at(i.operands[1].reg), regMap.at(i.operands[0].reg));
-				}
-			},
-			{
-				ir::Code::IToF,
-				[this](const ir::Instruction& i) {
-					op_itof(regMap.at(i.operands[0].reg), regMap.at(i.operands[1].reg));
-				}
-			}
-		};
-
-	public:
-		void operator()(const ir::Instruction& i) override {
-			emitterMap.at(i.code)( i );
-		}
-	};
+#pragma once
+#include <exception>
+#include <algorithm>
+#include <unordered_map>
+#include <numbers>
+#include <functional>
+#include <cmath>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include "binary_encoder.h"
+#include "compile_options.h"
+#include "cpu_features.h"
+
+namespace exprjit
+{
+	//todo: unops and regextbit - unused? wrong? wtf
+
+	template<typename T>
+	concept Arithmetic = std::floating_point<T> || std::integral<T>;
+
+	class X86_64 : public BinaryEncoder {
+	public:
+		struct CallingConvention;
+
+		// Changes whenever the emitted code changes, persisted code of other versions is discarded.
+		constexpr static uint32_t Version = 20;
+
+		X86_64(binary_t bin, size_t integerArgs, size_t floatArgs, const CallingConvention& cc = native()) 
+			: BinaryEncoder(bin, integerArgs, floatArgs), m_convention(cc) { 
+			buildPools();
+		}
+
+		X86_64(binary_t bin, std::vector<DataType> arguments, const CallingConvention& cc = native()) 
+			: BinaryEncoder(bin, std::move(arguments)), m_convention(cc) { 
+			buildPools();
+		}
+
+		X86_64(binary_t bin, std::vector<DataType> arguments, const CompileOptions& options, const CallingConvention& cc = native(), const CpuFeatures& features = CpuFeatures::host()) 
+			: BinaryEncoder(bin, std::move(arguments)), m_convention(cc), m_options(options), m_features(features) { 
+			buildPools();
+		}
+
+	private:
+#pragma region Registers
+		constexpr static uint32_t RAX = 0b000;
+		constexpr static uint32_t RCX = 0b001;
+		constexpr static uint32_t RDX = 0b010;
+		constexpr static uint32_t RBX = 0b011;
+		constexpr static uint32_t RSP = 0b100;
+		constexpr static uint32_t RBP = 0b101;
+		constexpr static uint32_t RSI = 0b110;
+		constexpr static uint32_t RDI = 0b111;
+
+		constexpr static uint32_t R8 = 0b1000;
+		constexpr static uint32_t R9 = 0b1001;
+		constexpr static uint32_t R10 = 0b1010;
+		constexpr static uint32_t R11 = 0b1011;
+		constexpr static uint32_t R12 = 0b1100;
+		constexpr static uint32_t R13 = 0b1101;
+		constexpr static uint32_t R14 = 0b1110;
+		constexpr static uint32_t R15 = 0b1111;
+
+		constexpr static uint32_t XMM0 = 0b000;
+		constexpr static uint32_t XMM1 = 0b001;
+		constexpr static uint32_t XMM2 = 0b010;
+		constexpr static uint32_t XMM3 = 0b011;
+		constexpr static uint32_t XMM4 = 0b100;
+		constexpr static uint32_t XMM5 = 0b101;
+		constexpr static uint32_t XMM6 = 0b110;
+		constexpr static uint32_t XMM7 = 0b111;
+		constexpr static uint32_t XMM8 = 0b1000;
+		constexpr static uint32_t XMM9 = 0b1001;
+		constexpr static uint32_t XMM10 = 0b1010;
+		constexpr static uint32_t XMM11 = 0b1011;
+		constexpr static uint32_t XMM12 = 0b1100;
+		constexpr static uint32_t XMM13 = 0b1101;
+		constexpr static uint32_t XMM14 = 0b1110;
+		constexpr static uint32_t XMM15 = 0b1111;
+
+		constexpr static uint32_t reg_ext = 0b1000;
+		constexpr static uint32_t reg_mask = 0b111;
+		constexpr static uint32_t reg_argi_win64[4] { RCX, RDX, R8, R9 };
+		constexpr static uint32_t reg_argf_win64[4] { XMM0, XMM1, XMM2, XMM3 };
+		constexpr static uint32_t reg_argi_sysv[6] { RDI, RSI, RDX, RCX, R8, R9 };
+		constexpr static uint32_t reg_argf_sysv[8] { XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7 };
+
+		// Allocatable registers, volatile ones first. Argument registers are dropped when the signature uses them.
+		// RDX is left out for div, XMM0-XMM3 for sin/cos.
+		constexpr static uint32_t reg_pooli_win64[10] { RCX, R8, R9, RSI, RDI, RBX, R12, R13, R14, R15 };
+		constexpr static uint32_t reg_poolf_win64[10] { XMM6, XMM7, XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15 };
+		constexpr static uint32_t reg_pooli_sysv[10] { RDI, RSI, RCX, R8, R9, RBX, R12, R13, R14, R15 };
+		constexpr static uint32_t reg_poolf_sysv[10] { XMM4, XMM5, XMM6, XMM7, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15 };
+#pragma endregion
+#pragma region ABI
+	public:
+		struct CallingConvention {
+			const uint32_t* integerArguments;
+			size_t integerArgumentCount;
+			const uint32_t* floatArguments;
+			size_t floatArgumentCount;
+			bool positional; // n-th argument takes the n-th register of its class whatever the other types are
+			uint32_t floatScratch[2]; // volatile, never used for arguments
+			const uint32_t* integerPool;
+			size_t integerPoolCount;
+			const uint32_t* floatPool;
+			size_t floatPoolCount;
+			uint32_t calleeSavedIntegers; // bit per register number
+			uint32_t calleeSavedFloats;
+			uint32_t shadowSpace; // bytes the caller reserves above the return address for the callee
+		};
+
+		constexpr static CallingConvention Win64 { 
+			reg_argi_win64, 4, reg_argf_win64, 4, true, { XMM4, XMM5 },
+			reg_pooli_win64, 10, reg_poolf_win64, 10,
+			1u << RBX | 1u << RBP | 1u << RSI | 1u << RDI | 1u << R12 | 1u << R13 | 1u << R14 | 1u << R15,
+			1u << XMM6 | 1u << XMM7 | 1u << XMM8 | 1u << XMM9 | 1u << XMM10 | 1u << XMM11 | 1u << XMM12 | 1u << XMM13 | 1u << XMM14 | 1u << XMM15,
+			32
+		};
+		constexpr static CallingConvention SystemV { 
+			reg_argi_sysv, 6, reg_argf_sysv, 8, false, { XMM8, XMM9 },
+			reg_pooli_sysv, 10, reg_poolf_sysv, 10,
+			1u << RBX | 1u << RBP | 1u << R12 | 1u << R13 | 1u << R14 | 1u << R15,
+			0,
+			0
+		};
+
+		static const CallingConvention& native() noexcept {
+#ifdef _WIN32
+			return Win64;
+#else
+			return SystemV;
+#endif
+		}
+
+		class ArgumentRegisterException : public std::exception {
+			const char* what() const noexcept override {
+				return "Argument is not passed in a register.";
+			}
+		};
+
+	private:
+		CallingConvention m_convention;
+		CompileOptions m_options;
+		CpuFeatures m_features = CpuFeatures::host();
+
+		size_t argumentSlot(size_t index) const {
+			DataType type = m_arguments.at(index);
+			if (m_convention.positional) return index;
+			size_t slot = 0;
+			for (size_t i = 0; i < index; ++i) {
+				if (isFloat(m_arguments[i]) == isFloat(type)) ++slot;
+			}
+			return slot;
+		}
+
+		bool inRegister(size_t index) const {
+			return argumentSlot(index) < ( isFloat(m_arguments.at(index)) ? m_convention.floatArgumentCount : m_convention.integerArgumentCount );
+		}
+
+		uint32_t argumentRegister(size_t index) const {
+			DataType type = m_arguments.at(index);
+			size_t slot = argumentSlot(index);
+			if (type == DataType::Integer) {
+				if (slot >= m_convention.integerArgumentCount) throw ArgumentRegisterException();
+				return m_convention.integerArguments[slot];
+			}
+			if (slot >= m_convention.floatArgumentCount) throw ArgumentRegisterException();
+			return m_convention.floatArguments[slot];
+		}
+
+		std::vector<uint32_t> m_integerPool;
+		std::vector<uint32_t> m_floatPool;
+
+		void buildPools() {
+			auto build = [this](std::vector<uint32_t>& pool, DataType type, const uint32_t* regs, size_t count, size_t argumentCount) {
+				for (size_t r = 0; r < count; ++r) {
+					bool argument = false;
+					for (size_t a = 0; a < m_arguments.size(); ++a) {
+						if (isFloat(m_arguments[a]) == isFloat(type) && argumentSlot(a) < argumentCount && argumentRegister(a) == regs[r]) argument = true;
+					}
+					if (!argument) pool.push_back(regs[r]);
+				}
+			};
+			build(m_integerPool, DataType::Integer, m_convention.integerPool, m_convention.integerPoolCount, m_convention.integerArgumentCount);
+			build(m_floatPool, DataType::Float, m_convention.floatPool, m_convention.floatPoolCount, m_convention.floatArgumentCount);
+		}
+
+		// Callee-saved registers pushed and stack reserved by Enter, undone before every Ret.
+		std::vector<uint32_t> m_savedIntegers;
+		std::vector<uint32_t> m_savedFloats;
+		uint32_t m_frameSize = 0;
+		uint32_t m_floatSaveOffset = 0;
+		uint64_t m_poolMask = 0;
+
+		// Open loops: the head position, the rel32 displacement of the exit jump, patched by LoopEnd, and the lanes.
+		struct Loop {
+			size_t head;
+			size_t exit;
+			size_t lanes;
+		};
+		std::vector<Loop> m_loops;
+		size_t m_lanes = 1;				// of the loop being emitted
+		bool m_upperDirty = false;		// 256-bit registers were written since the last vzeroupper
+		uint32_t m_slotSize = 8;
+		bool m_single = false;			// Float instructions work on Single values, set by Precision
+#pragma endregion
+#pragma region REX
+		constexpr static uint32_t m_rex_base = 0b01000000;
+		constexpr static uint32_t m_rex_w = 0b1000;
+		constexpr static uint32_t m_rex_r = 0b0100; //ext REG
+		constexpr static uint32_t m_rex_x = 0b0010;
+		constexpr static uint32_t m_rex_b = 0b0001; //ext R/M
+
+		constexpr static uint32_t rexw(uint32_t reg, uint32_t rm) {
+			return m_rex_base | m_rex_w | ( reg & reg_ext ? m_rex_r : 0 ) | ( rm & reg_ext ? m_rex_b : 0 );
+		}
+		constexpr static uint32_t rex(uint32_t reg, uint32_t rm) {
+			return m_rex_base | ( reg & reg_ext ? m_rex_r : 0 ) | ( rm & reg_ext ? m_rex_b : 0 );
+		}
+#pragma endregion
+#pragma region Opcodes
+		class BadOpcodeException : public std::exception {
+			const char* what() const noexcept override {
+				return "Bad opcode.";
+			}
+		};
+
+		enum class RegExtBit {
+			B, R
+		};
+
+		class Prefix {
+		public:
+			constexpr static uint32_t None = 0;
+			constexpr static uint32_t REX = 1 << 0;
+			constexpr static uint32_t REXF = 1 << 1;
+			constexpr static uint32_t x66 = 1 << 2;
+			constexpr static uint32_t xF2 = 1 << 3;
+			constexpr static uint32_t REXN = 1 << 4; // REX without W, only for extended registers
+			constexpr static uint32_t xF3 = 1 << 5;
+			constexpr static uint32_t M0F38 = 1 << 6; // VEX opcode maps, 0F by default
+			constexpr static uint32_t M0F3A = 1 << 7;
+			constexpr static uint32_t L256 = 1 << 8; // VEX.L, 256-bit vectors
+			constexpr static uint32_t Fp = 1 << 9; // double by default, Single after Precision: ss/ps forms
+
+			constexpr Prefix(uint32_t v) : m_value(v) { }
+
+			constexpr bool has(uint32_t v) const {
+				return m_value & v;
+			}
+			constexpr bool has(Prefix r) const {
+				return m_value & r.m_value;
+			}
+
+		private:
+			uint32_t m_value;
+		};
+
+		// [base + index * scale + disp] operand, [rip + constant disp of the pool] when base is RIP.
+		struct Mem {
+			uint32_t base;
+			int32_t disp;
+			uint32_t index = NoIndex;
+			uint32_t scale = 1;
+		};
+		constexpr static uint32_t RIP = 0x100;
+		constexpr static uint32_t NoIndex = 0x100;
+
+		// Argument the caller passed on the stack, between the prologue and the epilogue. Stack arguments follow
+		// the return address and the shadow space in their order, 8 bytes each.
+		Mem stackArgument(size_t index) const {
+			int32_t n = 0;
+			for (size_t a = 0; a < index; ++a) {
+				if (!inRegister(a)) ++n;
+			}
+			return { RSP, (int32_t)( m_frameSize + m_savedIntegers.size() * 8 + 8 + m_convention.shadowSpace ) + 8 * n };
+		}
+
+		struct Instruction {
+			enum class Type {
+				Vop,		// No args
+				Binop,	// /r
+				Digop,	// /digit
+				Unop,	// +r*
+				Vex		// /r, VEX encoded with a second source in vvvv
+			};
+
+			static Instruction vop(X86_64& emitter, Opcode code) {
+				return Instruction(emitter, code, Type::Vop, Prefix::None);
+			}
+			static Instruction unop(X86_64& emitter, Opcode code, Prefix prefix, RegExtBit rext) {
+				return Instruction(emitter, code, Type::Unop, prefix, rext);
+			}
+			static Instruction binop(X86_64& emitter, Opcode code, Prefix prefix) {
+				return Instruction(emitter, code, Type::Binop, prefix);
+			}
+			// Prefix selects the implied legacy prefix (x66, xF3, xF2), the opcode map and W (REXF).
+			static Instruction vex(X86_64& emitter, Opcode code, Prefix prefix) {
+				return Instruction(emitter, code, Type::Vex, prefix);
+			}
+			static Instruction digop(X86_64& emitter, Opcode code, Prefix prefix, uint32_t digit) {
+				auto op = Instruction(emitter, code, Type::Digop, prefix);
+				op.m_digit = digit;
+				return op;
+			}
+
+			void operator()() {
+#ifndef NDEBUG
+				if (m_type != Type::Vop) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif 
+				m_emitter.emit(m_code);
+			}
+			void operator()(uint32_t reg, uint32_t rm) {
+#ifndef NDEBUG
+				if (m_type != Type::Binop) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif
+				legacyPrefix();
+
+				if (m_prefix.has(Prefix::REXF) || (m_prefix.has(Prefix::REX) && ( reg & reg_ext || rm & reg_ext ) ))
+					m_emitter.emit(rexw(reg, rm));
+				else if (m_prefix.has(Prefix::REXN) && ( reg & reg_ext || rm & reg_ext ))
+					m_emitter.emit(rex(reg, rm));
+
+				m_emitter.emit(
+					m_code,
+					modrm_rr(reg, rm)
+				);
+			}
+			void operator()(uint32_t reg, Mem rm) {
+#ifndef NDEBUG
+				if (m_type != Type::Binop) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif
+				legacyPrefix();
+
+				uint32_t x = rm.index != NoIndex && rm.index & reg_ext ? m_rex_x : 0;
+				if (m_prefix.has(Prefix::REXF) || (m_prefix.has(Prefix::REX) && ( reg & reg_ext || rm.base & reg_ext || x ) ))
+					m_emitter.emit(rexw(reg, rm.base) | x);
+				else if (m_prefix.has(Prefix::REXN) && ( reg & reg_ext || rm.base & reg_ext || x ))
+					m_emitter.emit(rex(reg, rm.base) | x);
+
+				memory(reg, rm);
+			}
+			void operator()(uint32_t reg, uint32_t vvvv, uint32_t rm) {
+#ifndef NDEBUG
+				if (m_type != Type::Vex) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif
+				vex(reg, vvvv, rm);
+				m_emitter.emit(
+					m_code,
+					modrm_rr(reg, rm)
+				);
+			}
+			void operator()(uint32_t reg, uint32_t vvvv, Mem rm) {
+#ifndef NDEBUG
+				if (m_type != Type::Vex) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif
+				vex(reg, vvvv, rm.base);
+				memory(reg, rm);
+			}
+			void operator()(Mem rm) {
+#ifndef NDEBUG
+				if (m_type != Type::Digop) [[unlikely]] {
+					throw BadOpcodeException();
+				}
+#endif
+				if (m_prefix.has(Prefix::REXF) || ( m_prefix.has(Prefix::REX) && rm.base & reg_ext )) m_emitter.emit(rexw(0, rm.base));
+				else if (m_prefix.has(Prefix::REXN) && rm.base & reg_ext) m_emitter.emit(rex(0, rm.base));
+				memory(m_digit, rm);
+			}
+			void operator()(uint32_t r) {
+				switch (m_type) {
+					case Type::Unop:
+						legacyPrefix();
+
+						if (m_prefix.has(Prefix::REXF) || ( m_prefix.has(Prefix::REX) && r & reg_ext )) {
+							m_emitter.emit(
+								m_rex_base | m_rex_w | ( r & reg_ext ? (m_rext == RegExtBit::B ? m_rex_b : m_rex_r) : 0 )
+							);
+						}
+						else if (m_prefix.has(Prefix::REXN) && r & reg_ext) {
+							m_emitter.emit(m_rex_base | ( m_rext == RegExtBit::B ? m_rex_b : m_rex_r ));
+						}
+						m_emitter.emit(m_code | ( r & reg_mask ));
+						break;
+					case Type::Digop:
+						legacyPrefix();
+
+						if (m_prefix.has(Prefix::REXF) || ( m_prefix.has(Prefix::REX) && r & reg_ext )) {
+							m_emitter.emit(m_rex_base | m_rex_w | ( r & reg_ext ? ( m_rext == RegExtBit::B ? m_rex_b : m_rex_r ) : 0 ));
+						}
+						else if (m_prefix.has(Prefix::REXN) && r & reg_ext) {
+							m_emitter.emit(rex(0, r));
+						}
+						m_emitter.emit(
+							m_code,
+							modrm_rr(m_digit, r)
+						);
+						break;
+#ifndef NDEBUG
+					[[unlikely]] default:
+						throw BadOpcodeException();
+#endif
+				}
+			}
+
+		private:
+			// Fp instructions in Single precision: 66 (pd) is dropped and F2 (sd) becomes F3 (ss),
+			// except for VEX forms with W, FMA, which clear it instead.
+			bool single() const noexcept {
+				return m_prefix.has(Prefix::Fp) && m_emitter.m_single;
+			}
+
+			void legacyPrefix() {
+				if (m_prefix.has(Prefix::x66)) {
+					if (!single()) m_emitter.emit((uint8_t)0x66);
+				}
+				else if (m_prefix.has(Prefix::xF2)) m_emitter.emit((uint8_t)( single() ? 0xF3 : 0xF2 ));
+				else if (m_prefix.has(Prefix::xF3)) m_emitter.emit((uint8_t)0xF3);
+			}
+
+			// VEX prefix: implied 66/F3/F2 in pp, the 0F/0F38/0F3A map, W, and R, B and vvvv stored inverted.
+			void vex(uint32_t reg, uint32_t vvvv, uint32_t rmBase) {
+				uint32_t pp = m_prefix.has(Prefix::x66) ? 0b01 : m_prefix.has(Prefix::xF3) ? 0b10 : m_prefix.has(Prefix::xF2) ? 0b11 : 0b00;
+				bool fma = m_prefix.has(Prefix::REXF);
+				if (single() && !fma) pp = pp == 0b01 ? 0b00 : pp == 0b11 ? 0b10 : pp;
+				uint32_t map = m_prefix.has(Prefix::M0F38) ? 0b10 : m_prefix.has(Prefix::M0F3A) ? 0b11 : 0b01;
+				uint32_t w = fma && !single() ? 1 : 0;
+				uint32_t r = reg & reg_ext ? 0 : 0x80, x = 0x40, b = rmBase & reg_ext ? 0 : 0x20;
+				uint32_t tail = ( ~vvvv & 0b1111 ) << 3 | ( m_prefix.has(Prefix::L256) ? 0b100 : 0 ) | pp;
+				if (map == 0b01 && w == 0 && b) {
+					m_emitter.emit((uint8_t)0xC5, (uint8_t)( r | tail ));
+				}
+				else {
+					m_emitter.emit((uint8_t)0xC4, (uint8_t)( r | x | b | map ), (uint8_t)( w << 7 | tail ));
+				}
+			}
+
+			// Opcode, ModRM, SIB and displacement of a memory operand.
+			// RIP-relative displacements are left to X86_64::finalize, which places the pool.
+			void memory(uint32_t reg, Mem rm) {
+				if (rm.base == RIP) {
+					m_emitter.emit(m_code, (unsigned char)( ( ( reg & reg_mask ) << 3 ) | 0b101 ));
+					m_emitter.constantReference((uint32_t)rm.disp);
+					return;
+				}
+				uint32_t mod = rm.disp == 0 && ( rm.base & reg_mask ) != RBP ? 0b00 : rm.disp >= -128 && rm.disp < 128 ? 0b01 : 0b10;
+				if (rm.index != NoIndex) {
+					m_emitter.emit(m_code, (unsigned char)( ( mod << 6 ) | ( ( reg & reg_mask ) << 3 ) | RSP ));
+					m_emitter.emit((uint8_t)( std::countr_zero(rm.scale) << 6 | ( rm.index & reg_mask ) << 3 | ( rm.base & reg_mask ) ));
+				}
+				else {
+					m_emitter.emit(m_code, (unsigned char)( ( mod << 6 ) | ( ( reg & reg_mask ) << 3 ) | ( rm.base & reg_mask ) ));
+					if (( rm.base & reg_mask ) == RSP) m_emitter.emit((uint8_t)0x24); // SIB: base only
+				}
+				if (mod == 0b01) m_emitter.value<int8_t>((int8_t)rm.disp);
+				else if (mod == 0b10) m_emitter.value<int32_t>(rm.disp);
+			}
+
+			static unsigned char modrm_rr(uint32_t reg, uint32_t rm) noexcept {
+				return (unsigned char)(
+					( 0b11u << 6u ) |
+					( ( reg & reg_mask ) << 3 ) |
+					( ( rm & reg_mask ) )
+					);
+			}
+
+			X86_64& m_emitter;
+			Type m_type;
+			uint32_t m_digit;
+			Opcode m_code;
+			Prefix m_prefix;
+			RegExtBit m_rext;
+
+			Instruction(X86_64& emitter, const Opcode& code, Type type, Prefix prefix, RegExtBit rext = RegExtBit::B) noexcept
+				: m_type(type), m_emitter(emitter), m_code(code), m_prefix(prefix), m_digit(), m_rext(rext) { }
+		};
+
+		Instruction op_ret		= Instruction::vop(*this, { 0xC3 });
+
+		Instruction op_movvi		= Instruction::unop(*this,	{ 0xB8			}, Prefix::REXF,		RegExtBit::B	);//[REG = IMM		]
+		Instruction op_movvi32	= Instruction::unop(*this,	{ 0xB8			}, Prefix::REXN,		RegExtBit::B	);//[REG = U32, zero extended]
+		Instruction op_movrvi	= Instruction::digop(*this,	{ 0xC7			}, Prefix::REXF,		0			);//[RM = V32, sign extended]
+		Instruction op_pushvi	= Instruction::vop(*this,	{ 0x68			}								);//[push V32		]
+		Instruction op_pushvi8	= Instruction::vop(*this,	{ 0x6A			}								);//[push V8		]
+		Instruction op_pushm		= Instruction::digop(*this,	{ 0xFF			}, Prefix::None,		6			);//[push M64		]
+		Instruction op_popi		= Instruction::unop(*this,	{ 0x58			}, Prefix::REX,		RegExtBit::B	);
+		Instruction op_pushi		= Instruction::unop(*this,	{ 0x50			}, Prefix::REX,		RegExtBit::B	);
+		Instruction op_movri		= Instruction::binop(*this,	{ 0x8B			}, Prefix::REXF					);//[REG = RM		]
+		Instruction op_movmi		= Instruction::binop(*this,	{ 0x89			}, Prefix::REXF					);//[RM = REG		]
+		Instruction op_addri		= Instruction::binop(*this,	{ 0x03			}, Prefix::REXF					);//[REG = REG + R/M	]
+		Instruction op_subri		= Instruction::binop(*this,	{ 0x2B			}, Prefix::REXF					);//[REG = REG - R/M]
+		Instruction op_lea		= Instruction::binop(*this,	{ 0x8D			}, Prefix::REXF					);//[REG = address of M]
+		Instruction op_subvi 	= Instruction::digop(*this,	{ 0x81			}, Prefix::REXF,		5			);//[R/M = R/M - V32]
+		Instruction op_andvi 	= Instruction::digop(*this,	{ 0x81			}, Prefix::REXF,		4			);//[R/M = R/M & V32]
+		Instruction op_addvi 	= Instruction::digop(*this,	{ 0x81			}, Prefix::REXF,		0			);//[R/M = R/M + V32]
+		Instruction op_subvi8 	= Instruction::digop(*this,	{ 0x83			}, Prefix::REXF,		5			);//[R/M = R/M - V8]
+		Instruction op_andvi8 	= Instruction::digop(*this,	{ 0x83			}, Prefix::REXF,		4			);//[R/M = R/M & V8]
+		Instruction op_addvi8 	= Instruction::digop(*this,	{ 0x83			}, Prefix::REXF,		0			);//[R/M = R/M + V8]
+		Instruction op_cmpvi 	= Instruction::digop(*this,	{ 0x81			}, Prefix::REXF,		7			);//[flags = R/M - V32]
+		Instruction op_cmpvi8 	= Instruction::digop(*this,	{ 0x83			}, Prefix::REXF,		7			);//[flags = R/M - V8]
+		Instruction op_jmp		= Instruction::vop(*this,	{ 0xE9			}								);//[jmp rel32		]
+		Instruction op_jl		= Instruction::vop(*this,	{ 0x0F, 0x8C		}								);//[jmp rel32 if less, signed]
+		Instruction op_mulrvi8	= Instruction::binop(*this,	{ 0x6B			}, Prefix::REXF					);//[REG = R/M * V8]
+		Instruction op_xorri32	= Instruction::binop(*this,	{ 0x33			}, Prefix::REXN					);//[REG = REG ^ R/M, 32 bits, zero extended]
+		Instruction op_mulri		= Instruction::binop(*this,	{ 0x0F, 0xAF		}, Prefix::REXF					);//[REG = REG * R/M	]
+		Instruction op_xorri		= Instruction::binop(*this,	{ 0x33			}, Prefix::REXF					);//[REG = REG ^ R/M	]
+		Instruction op_divri		= Instruction::digop(*this,	{ 0xF7			}, Prefix::REXF,		7			);//[RAX, RDX = RDX:RAX / RM, signed]
+		Instruction op_imulr		= Instruction::digop(*this,	{ 0xF7			}, Prefix::REXF,		5			);//[RDX:RAX = RAX * RM, signed]
+		Instruction op_mulrvi	= Instruction::binop(*this,	{ 0x69			}, Prefix::REXF					);//[REG = R/M * V32]
+		Instruction op_cqo		= Instruction::vop(*this,	{ 0x48, 0x99		}								);//[RDX = sign of RAX]
+		Instruction op_negri		= Instruction::digop(*this,	{ 0xF7			}, Prefix::REXF,		3			);//[RM = -RM		]
+		Instruction op_sarvi		= Instruction::digop(*this,	{ 0xC1			}, Prefix::REXF,		7			);//[RM = RM >>>	 i8 ]
+		Instruction op_shlvi		= Instruction::digop(*this,	{ 0xC1			}, Prefix::REXF,		4			);//[RM = RM <<	 i8 ]
+		Instruction op_shrvi		= Instruction::digop(*this,	{ 0xC1			}, Prefix::REXF,		5			);//[RM = RM >>	 i8, logical ]
+		Instruction op_callr		= Instruction::digop(*this,	{ 0xFF			}, Prefix::REX,		2			);//[call RM		]
+		
+
+		Instruction op_loadf		= Instruction::binop(*this, { 0x0F, 0x6E			}, Prefix::x66 | Prefix::REXF);	// [XMM = R/M]
+		Instruction op_storef	= Instruction::binop(*this, { 0x0F, 0x7E			}, Prefix::x66 | Prefix::REXF); // [R/M = XMM]
+		Instruction op_movf		= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN);
+		Instruction op_movmf		= Instruction::binop(*this, { 0x0F, 0x11			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN); // [M = XMM]
+		Instruction op_movdqu	= Instruction::binop(*this, { 0x0F, 0x6F			}, Prefix::xF3 | Prefix::REXN); // [XMM = M128]
+		Instruction op_movmdqu	= Instruction::binop(*this, { 0x0F, 0x7F			}, Prefix::xF3 | Prefix::REXN); // [M128 = XMM]
+		Instruction op_addf		= Instruction::binop(*this, { 0x0F, 0x58			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN);
+		Instruction op_subf		= Instruction::binop(*this, { 0x0F, 0x5C			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN);
+		Instruction op_mulf		= Instruction::binop(*this, { 0x0F, 0x59			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN);
+		Instruction op_divf		= Instruction::binop(*this, { 0x0F, 0x5E			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN);
+		Instruction op_xorf		= Instruction::binop(*this, { 0x0F, 0x57			}, Prefix::x66 | Prefix::REXN); // [REG = REG ^ R/M]
+		Instruction op_andf		= Instruction::binop(*this, { 0x0F, 0x54			}, Prefix::x66 | Prefix::REXN); // [REG = REG & R/M]
+		Instruction op_andnf		= Instruction::binop(*this, { 0x0F, 0x55			}, Prefix::x66 | Prefix::REXN); // [REG = ~REG & R/M]
+		Instruction op_orf		= Instruction::binop(*this, { 0x0F, 0x56			}, Prefix::x66 | Prefix::REXN); // [REG = REG | R/M]
+		Instruction op_roundf	= Instruction::binop(*this, { 0x0F, 0x3A, 0x0B	}, Prefix::x66 | Prefix::REXN); // [REG = round R/M] [i8]
+		Instruction op_roundf32	= Instruction::binop(*this, { 0x0F, 0x3A, 0x0A	}, Prefix::x66 | Prefix::REXN); // roundss [i8]
+		Instruction op_cvtss2sd	= Instruction::binop(*this, { 0x0F, 0x5A			}, Prefix::xF3 | Prefix::REXN); // [REG = (D) R/M]
+		Instruction op_cvtsd2ss	= Instruction::binop(*this, { 0x0F, 0x5A			}, Prefix::xF2 | Prefix::REXN); // [REG = (S) R/M]
+		// Moves of a given width regardless of the precision.
+		Instruction op_movss		= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::xF3 | Prefix::REXN);
+		Instruction op_movmss	= Instruction::binop(*this, { 0x0F, 0x11			}, Prefix::xF3 | Prefix::REXN);
+		Instruction op_movsd		= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::xF2 | Prefix::REXN);
+		Instruction op_movmsd	= Instruction::binop(*this, { 0x0F, 0x11			}, Prefix::xF2 | Prefix::REXN);
+
+		Instruction op_cmpf		= Instruction::binop(*this, { 0x0F, 0xC2			}, Prefix::xF2 | Prefix::Fp | Prefix::REXN); // [REG = REG cmp R/M ? ~0 : 0] [i8]
+
+		// AVX: [REG = VVVV op R/M]
+		Instruction op_vaddf		= Instruction::vex(*this, { 0x58 }, Prefix::xF2 | Prefix::Fp);
+		Instruction op_vsubf		= Instruction::vex(*this, { 0x5C }, Prefix::xF2 | Prefix::Fp);
+		Instruction op_vmulf		= Instruction::vex(*this, { 0x59 }, Prefix::xF2 | Prefix::Fp);
+		Instruction op_vdivf		= Instruction::vex(*this, { 0x5E }, Prefix::xF2 | Prefix::Fp);
+		Instruction op_vcmpf		= Instruction::vex(*this, { 0xC2 }, Prefix::xF2 | Prefix::Fp); // [i8]
+		Instruction op_vxorf		= Instruction::vex(*this, { 0x57 }, Prefix::x66);
+		Instruction op_vandf		= Instruction::vex(*this, { 0x54 }, Prefix::x66);
+		Instruction op_vandnf	= Instruction::vex(*this, { 0x55 }, Prefix::x66); // [REG = ~VVVV & R/M]
+		Instruction op_vorf		= Instruction::vex(*this, { 0x56 }, Prefix::x66);
+		Instruction op_vroundf	= Instruction::vex(*this, { 0x0B }, Prefix::x66 | Prefix::M0F3A); // [i8]
+		Instruction op_vroundf32	= Instruction::vex(*this, { 0x0A }, Prefix::x66 | Prefix::M0F3A); // [i8]
+		Instruction op_vfmadd213f	= Instruction::vex(*this, { 0xA9 }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF); // [REG = REG * VVVV + R/M]
+		Instruction op_vfmadd231f	= Instruction::vex(*this, { 0xB9 }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF); // [REG = REG + VVVV * R/M]
+		Instruction op_vfnmadd231f	= Instruction::vex(*this, { 0xBD }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF); // [REG = REG - VVVV * R/M]
+
+		// Packed double forms for batch loops: SSE2 on 2 lanes, 256-bit AVX on 4.
+		Instruction op_movupd	= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::x66 | Prefix::Fp | Prefix::REXN); // [XMM = M128]
+		Instruction op_movmupd	= Instruction::binop(*this, { 0x0F, 0x11			}, Prefix::x66 | Prefix::Fp | Prefix::REXN); // [M128 = XMM]
+		Instruction op_movapd	= Instruction::binop(*this, { 0x0F, 0x28			}, Prefix::x66 | Prefix::Fp | Prefix::REXN); // [XMM = XMM]
+		Instruction op_addp		= Instruction::binop(*this, { 0x0F, 0x58			}, Prefix::x66 | Prefix::Fp | Prefix::REXN);
+		Instruction op_subp		= Instruction::binop(*this, { 0x0F, 0x5C			}, Prefix::x66 | Prefix::Fp | Prefix::REXN);
+		Instruction op_mulp		= Instruction::binop(*this, { 0x0F, 0x59			}, Prefix::x66 | Prefix::Fp | Prefix::REXN);
+		Instruction op_divp		= Instruction::binop(*this, { 0x0F, 0x5E			}, Prefix::x66 | Prefix::Fp | Prefix::REXN);
+		Instruction op_cmpp		= Instruction::binop(*this, { 0x0F, 0xC2			}, Prefix::x66 | Prefix::Fp | Prefix::REXN); // [i8]
+		Instruction op_roundp	= Instruction::binop(*this, { 0x0F, 0x3A, 0x09	}, Prefix::x66 | Prefix::REXN); // [i8]
+		Instruction op_roundp32	= Instruction::binop(*this, { 0x0F, 0x3A, 0x08	}, Prefix::x66 | Prefix::REXN); // roundps [i8]
+		Instruction op_cvtps2pd	= Instruction::binop(*this, { 0x0F, 0x5A			}, Prefix::REXN);				// low 2 floats to doubles
+		Instruction op_cvtpd2ps	= Instruction::binop(*this, { 0x0F, 0x5A			}, Prefix::x66 | Prefix::REXN); // to the low 2 floats
+		Instruction op_shufps	= Instruction::binop(*this, { 0x0F, 0xC6			}, Prefix::REXN);				// [i8]
+		Instruction op_movups	= Instruction::binop(*this, { 0x0F, 0x10			}, Prefix::REXN);
+		Instruction op_movmups	= Instruction::binop(*this, { 0x0F, 0x11			}, Prefix::REXN);
+		Instruction op_unpcklp	= Instruction::binop(*this, { 0x0F, 0x14			}, Prefix::x66 | Prefix::REXN); // [REG = low REG, low R/M]
+		Instruction op_unpcklps	= Instruction::binop(*this, { 0x0F, 0x14			}, Prefix::REXN);				// [REG = low 2 of REG and R/M interleaved]
+		Instruction op_movlhps	= Instruction::binop(*this, { 0x0F, 0x16			}, Prefix::REXN);				// [high REG = low R/M]
+		Instruction op_movhpd	= Instruction::binop(*this, { 0x0F, 0x16			}, Prefix::x66 | Prefix::REXN); // [high REG = M64]
+		Instruction op_movmhpd	= Instruction::binop(*this, { 0x0F, 0x17			}, Prefix::x66 | Prefix::REXN); // [M64 = high REG]
+		Instruction op_insertps	= Instruction::binop(*this, { 0x0F, 0x3A, 0x21	}, Prefix::x66 | Prefix::REXN); // [lane i8 >> 4 of REG = M32] SSE4.1
+		Instruction op_extractps	= Instruction::binop(*this, { 0x0F, 0x3A, 0x17	}, Prefix::x66 | Prefix::REXN); // [R/M32 = lane i8 of REG] SSE4.1
+		Instruction op_pshufd	= Instruction::binop(*this, { 0x0F, 0x70			}, Prefix::x66 | Prefix::REXN); // [REG = lanes of R/M picked by i8]
+		Instruction op_vmovp		= Instruction::vex(*this, { 0x10 }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vmovmp	= Instruction::vex(*this, { 0x11 }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vmovap	= Instruction::vex(*this, { 0x28 }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vaddp		= Instruction::vex(*this, { 0x58 }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vsubp		= Instruction::vex(*this, { 0x5C }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vmulp		= Instruction::vex(*this, { 0x59 }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vdivp		= Instruction::vex(*this, { 0x5E }, Prefix::x66 | Prefix::Fp | Prefix::L256);
+		Instruction op_vandp		= Instruction::vex(*this, { 0x54 }, Prefix::x66 | Prefix::L256);
+		Instruction op_vandnp	= Instruction::vex(*this, { 0x55 }, Prefix::x66 | Prefix::L256);
+		Instruction op_vorp		= Instruction::vex(*this, { 0x56 }, Prefix::x66 | Prefix::L256);
+		Instruction op_vxorp		= Instruction::vex(*this, { 0x57 }, Prefix::x66 | Prefix::L256);
+		Instruction op_vcmpp		= Instruction::vex(*this, { 0xC2 }, Prefix::x66 | Prefix::Fp | Prefix::L256); // [i8]
+		Instruction op_vroundp	= Instruction::vex(*this, { 0x09 }, Prefix::x66 | Prefix::M0F3A | Prefix::L256); // [i8]
+		Instruction op_vroundp32	= Instruction::vex(*this, { 0x08 }, Prefix::x66 | Prefix::M0F3A | Prefix::L256); // [i8]
+		Instruction op_vcvtps2pd	= Instruction::vex(*this, { 0x5A }, Prefix::L256);							// 4 floats from a 128-bit R/M
+		Instruction op_vcvtpd2ps	= Instruction::vex(*this, { 0x5A }, Prefix::x66 | Prefix::L256);			// to a 128-bit REG
+		Instruction op_vshufps	= Instruction::vex(*this, { 0xC6 }, Prefix::None);							// 128-bit [i8]
+		Instruction op_vmovss	= Instruction::vex(*this, { 0x10 }, Prefix::xF3);							// [REG = M32]
+		Instruction op_vmovmss	= Instruction::vex(*this, { 0x11 }, Prefix::xF3);
+		Instruction op_vmovsd	= Instruction::vex(*this, { 0x10 }, Prefix::xF2);
+		Instruction op_vmovmsd	= Instruction::vex(*this, { 0x11 }, Prefix::xF2);
+		Instruction op_vmovups	= Instruction::vex(*this, { 0x10 }, Prefix::None);							// 128-bit
+		Instruction op_vmovmups	= Instruction::vex(*this, { 0x11 }, Prefix::None);
+		Instruction op_vmovups256	= Instruction::vex(*this, { 0x10 }, Prefix::L256);
+		Instruction op_vmovmups256	= Instruction::vex(*this, { 0x11 }, Prefix::L256);
+		Instruction op_vfmadd213p	= Instruction::vex(*this, { 0xA8 }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF | Prefix::L256);
+		Instruction op_vfmadd231p	= Instruction::vex(*this, { 0xB8 }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF | Prefix::L256);
+		Instruction op_vfnmadd231p	= Instruction::vex(*this, { 0xBC }, Prefix::x66 | Prefix::Fp | Prefix::M0F38 | Prefix::REXF | Prefix::L256);
+		Instruction op_vunpcklp	= Instruction::vex(*this, { 0x14 }, Prefix::x66);							// 128-bit
+		Instruction op_vinsertf128	= Instruction::vex(*this, { 0x18 }, Prefix::x66 | Prefix::M0F3A | Prefix::L256); // [REG = VVVV with a half from R/M] [i8]
+		Instruction op_vextractf128	= Instruction::vex(*this, { 0x19 }, Prefix::x66 | Prefix::M0F3A | Prefix::L256); // [R/M = half i8 of REG]
+		Instruction op_vmovhpd	= Instruction::vex(*this, { 0x16 }, Prefix::x66);							// [REG = low VVVV, M64]
+		Instruction op_vmovmhpd	= Instruction::vex(*this, { 0x17 }, Prefix::x66);							// [M64 = high REG]
+		Instruction op_vinsertps	= Instruction::vex(*this, { 0x21 }, Prefix::x66 | Prefix::M0F3A);			// [REG = VVVV with lane i8 >> 4 from M32]
+		Instruction op_vextractps	= Instruction::vex(*this, { 0x17 }, Prefix::x66 | Prefix::M0F3A);			// [R/M32 = lane i8 of REG]
+		Instruction op_vzeroupper	= Instruction::vop(*this, { 0xC5, 0xF8, 0x77 });
+
+		Instruction op_pcmpeqw	= Instruction::binop(*this, { 0x0F, 0x75			}, Prefix::x66 | Prefix::REXN);
+		Instruction op_psllqv	= Instruction::digop(*this, { 0x0F, 0x73			}, Prefix::x66 | Prefix::REXN,		6); // ... [i8]
+		Instruction op_psrlqv	= Instruction::digop(*this, { 0x0F, 0x73			}, Prefix::x66 | Prefix::REXN,		2); // ... [i8]
+		Instruction op_pslldv	= Instruction::digop(*this, { 0x0F, 0x72			}, Prefix::x66 | Prefix::REXN,		6); // ... [i8]
+		Instruction op_psrldv	= Instruction::digop(*this, { 0x0F, 0x72			}, Prefix::x66 | Prefix::REXN,		2); // ... [i8]
+
+		Instruction op_ftoi		= Instruction::binop(*this, { 0x0F, 0x2D }, Prefix::xF2 | Prefix::Fp | Prefix::REXF); // [REG = (I) R/M]
+		Instruction op_ftoit		= Instruction::binop(*this, { 0x0F, 0x2C }, Prefix::xF2 | Prefix::Fp | Prefix::REXF); // [REG = (I) R/M], truncating
+		Instruction op_itof		= Instruction::binop(*this, { 0x0F, 0x2A }, Prefix::xF2 | Prefix::Fp | Prefix::REXF); // [R/M = (D) REG]
+
+#pragma endregion
+		
+		//uint64_t getBin(double v) {
+		//	union {
+		//		double vd;
+		//		uint64_t vi;
+		//	};
+		//	vd = v;
+		//	return vi;
+		//}
+
+		template<Arithmetic T >
+		void value(T value) {
+			union {
+				T vi;
+				unsigned char vc[sizeof(T)];
+			};
+			vi = value;
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				emit(vc[i]);
+			}
+		}
+
+		void pushf(uint32_t reg) {
+			op_storef(reg, R11);
+			op_pushi(R11);
+		}
+		void popf(uint32_t reg) {
+			op_popi(R11);
+			op_loadf(reg, R11);
+		}
+		void negf(uint32_t reg) {
+			xorf(reg, reg, signMask());
+		}
+		void genf1(uint32_t reg) {
+			op_pcmpeqw(reg, reg);
+			if (m_single) {
+				op_pslldv(reg);
+				value<uint8_t>(25);
+				op_psrldv(reg);
+				value<uint8_t>(2);
+				return;
+			}
+			op_psllqv(reg);
+			value<uint8_t>(54);
+			op_psrlqv(reg);
+			value<uint8_t>(2);
+		}
+		void loadfv(uint32_t reg, double v) {
+			op_movf(reg, pool(v));
+		}
+
+		// Constant pool, appended after the code by finalize. Entries are 32 bytes, mostly the value in every lane.
+		// The pool is 32-byte aligned within the code and CodeArena blocks and CodeCache entries are at least as aligned,
+		// so packed operations of either width may take entries as aligned memory operands.
+		struct ConstantReference {
+			size_t position; // of the rel32 displacement
+			uint32_t index;
+		};
+		std::vector<std::array<uint64_t, 4>> m_constants;
+		std::unordered_map<uint64_t, uint32_t> m_constantIndices;
+		std::vector<ConstantReference> m_constantReferences;
+
+		// Instructions taking these may not have an immediate after the displacement, it is relative to their end.
+		Mem poolBits(uint64_t bits) {
+			auto [it, inserted] = m_constantIndices.insert({ bits, (uint32_t)m_constants.size() });
+			if (inserted) m_constants.push_back({ bits, bits, bits, bits });
+			return { RIP, (int32_t)it->second };
+		}
+		// Entry of distinct lanes.
+		Mem poolVector(const std::array<uint64_t, 4>& lanes) {
+			auto it = std::find(m_constants.begin(), m_constants.end(), lanes);
+			if (it == m_constants.end()) it = m_constants.insert(it, lanes);
+			return { RIP, (int32_t)( it - m_constants.begin() ) };
+		}
+		// 0, 1, 2, ... in the lanes of the current precision.
+		Mem iota() {
+			if (!m_single) return poolVector({ std::bit_cast<uint64_t>(0.0), std::bit_cast<uint64_t>(1.0), std::bit_cast<uint64_t>(2.0), std::bit_cast<uint64_t>(3.0) });
+			std::array<uint64_t, 4> lanes;
+			for (uint32_t n = 0; n < 4; ++n) lanes[n] = std::bit_cast<uint32_t>(2.0f * n) | (uint64_t)std::bit_cast<uint32_t>(2.0f * n + 1) << 32;
+			return poolVector(lanes);
+		}
+		// Float constant in the current precision, a Single one repeated in both halves.
+		Mem pool(double v) {
+			if (!m_single) return poolBits(std::bit_cast<uint64_t>(v));
+			uint64_t bits = std::bit_cast<uint32_t>((float)v);
+			return poolBits(bits | bits << 32);
+		}
+		// Immediates of Float instructions hold the bits of a double.
+		Mem literal(uint64_t bits) {
+			return pool(std::bit_cast<double>(bits));
+		}
+		Mem signMask() {
+			return poolBits(m_single ? 0x8000000080000000 : 0x8000000000000000);
+		}
+		Mem absMask() {
+			return poolBits(m_single ? 0x7fffffff7fffffff : 0x7fffffffffffffff);
+		}
+		void constantReference(uint32_t index) {
+			m_constantReferences.push_back({ binary().size(), index });
+			value<int32_t>(0);
+		}
+
+		// r = v in the shortest encoding.
+		void movi(uint32_t r, int64_t v) {
+			if (v == 0) {
+				op_xorri32(r, r);
+			}
+			else if (v > 0 && v <= UINT32_MAX) {
+				op_movvi32(r);
+				value<uint32_t>((uint32_t)v);
+			}
+			else if (v < 0 && v >= INT32_MIN) {
+				op_movrvi(r);
+				value<int32_t>((int32_t)v);
+			}
+			else {
+				op_movvi(r);
+				value<int64_t>(v);
+			}
+		}
+		// r op= v, with an imm8 when v fits.
+		void immediate(Instruction& op8, Instruction& op32, uint32_t r, int32_t v) {
+			bool short8 = v >= INT8_MIN && v <= INT8_MAX;
+			( short8 ? op8 : op32 )( r );
+			if (short8) value<int8_t>((int8_t)v);
+			else value<int32_t>(v);
+		}
+		void addi(uint32_t r, int32_t v) { immediate(op_addvi8, op_addvi, r, v); }
+		void subi(uint32_t r, int32_t v) { immediate(op_subvi8, op_subvi, r, v); }
+		void andi(uint32_t r, int32_t v) { immediate(op_andvi8, op_andvi, r, v); }
+		void muli(uint32_t r, int32_t v) {
+			if (v >= INT8_MIN && v <= INT8_MAX) {
+				op_mulrvi8(r, r);
+				value<int8_t>((int8_t)v);
+			}
+			else {
+				op_mulrvi(r, r);
+				value<int32_t>(v);
+			}
+		}
+
+		// dst = a op b: the VEX form with AVX, otherwise a copy to dst and the two-operand SSE form.
+		// Without AVX dst may be b only if the operation commutes.
+		void fop(Instruction& sse, Instruction& avx, uint32_t dst, uint32_t a, uint32_t b, bool commutes = true) {
+			if (m_features.avx) {
+				avx(dst, a, b);
+				return;
+			}
+			if (dst == b && dst != a) {
+				if (!commutes) throw BadOpcodeException();
+				std::swap(a, b);
+			}
+			if (dst != a) op_movf(dst, a);
+			sse(dst, b);
+		}
+		void fop(Instruction& sse, Instruction& avx, uint32_t dst, uint32_t a, Mem b) {
+			if (m_features.avx) {
+				avx(dst, a, b);
+				return;
+			}
+			if (dst != a) op_movf(dst, a);
+			sse(dst, b);
+		}
+		void addf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_addf, op_vaddf, dst, a, b); }
+		void subf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_subf, op_vsubf, dst, a, b, false); }
+		void mulf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_mulf, op_vmulf, dst, a, b); }
+		void divf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_divf, op_vdivf, dst, a, b, false); }
+		void andf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_andf, op_vandf, dst, a, b); }
+		void andnf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_andnf, op_vandnf, dst, a, b, false); }
+		void orf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_orf, op_vorf, dst, a, b); }
+		void xorf(uint32_t dst, uint32_t a, uint32_t b) { fop(op_xorf, op_vxorf, dst, a, b); }
+		void addf(uint32_t dst, uint32_t a, Mem b) { fop(op_addf, op_vaddf, dst, a, b); }
+		void mulf(uint32_t dst, uint32_t a, Mem b) { fop(op_mulf, op_vmulf, dst, a, b); }
+		void divf(uint32_t dst, uint32_t a, Mem b) { fop(op_divf, op_vdivf, dst, a, b); }
+		void andf(uint32_t dst, uint32_t a, Mem b) { fop(op_andf, op_vandf, dst, a, b); }
+		void xorf(uint32_t dst, uint32_t a, Mem b) { fop(op_xorf, op_vxorf, dst, a, b); }
+		// dst = a predicate b ? ~0 : 0, predicates as cmpp.
+		void cmpf(uint32_t dst, uint32_t a, uint32_t b, uint8_t predicate) {
+			fop(op_cmpf, op_vcmpf, dst, a, b, false);
+			value<uint8_t>(predicate);
+		}
+
+		// reg = reg * a + b, fused (one rounding) with FMA.
+		void mulAddf(uint32_t reg, uint32_t a, Mem b) {
+			if (m_features.fma) {
+				op_vfmadd213f(reg, a, b);
+				return;
+			}
+			mulf(reg, reg, a);
+			addf(reg, reg, b);
+		}
+		// reg = reg + a * b, fused with FMA. Clobbers tmp otherwise.
+		void addMulf(uint32_t reg, uint32_t a, Mem b, uint32_t tmp) {
+			if (m_features.fma) {
+				op_vfmadd231f(reg, a, b);
+				return;
+			}
+			mulf(tmp, a, b);
+			addf(reg, reg, tmp);
+		}
+		// reg = reg - a * b, fused with FMA. Clobbers tmp otherwise.
+		void mulSubf(uint32_t reg, uint32_t a, Mem b, uint32_t tmp) {
+			if (m_features.fma) {
+				op_vfnmadd231f(reg, a, b);
+				return;
+			}
+			mulf(tmp, a, b);
+			subf(reg, reg, tmp);
+		}
+
+		// dst = src rounded with roundsd's mode (8 nearest, 9 down, 10 up), with SSE4.1 or AVX.
+		void roundsf(uint32_t dst, uint32_t src, uint8_t mode) {
+			if (m_features.avx) ( m_single ? op_vroundf32 : op_vroundf )(dst, src, src);
+			else ( m_single ? op_roundf32 : op_roundf )(dst, src);
+			value<uint8_t>(mode);
+		}
+
+		// dst = src rounded to nearest. roundsd needs SSE4.1, the fallback goes through R11
+		// and is only exact for |src| < 2^63.
+		void roundNearestf(uint32_t dst, uint32_t src) {
+			if (m_features.avx || m_features.sse41) {
+				roundsf(dst, src, 8);
+			}
+			else {
+				op_ftoi(R11, src);
+				op_itof(dst, R11);
+			}
+		}
+
+		// xra = floor(xra).
+		void floorf(uint32_t xra) {
+			if (m_features.avx || m_features.sse41) {
+				roundsf(xra, xra, 9);
+				return;
+			}
+			// SSE2: truncate through R11, subtract 1 where that rounded up, keep the sign of -0.
+			// Values of 2^52 (2^23 for Single) and above are integral already and kept as they are, like NaN.
+			saveArguments();
+			op_ftoit(R11, xra);
+			op_itof(XMM0, R11);
+			op_movf(XMM1, xra);
+			op_cmpf(XMM1, XMM0);
+			value<uint8_t>(1);						// x < trunc x
+			genf1(XMM3);
+			op_andf(XMM1, XMM3);
+			op_subf(XMM0, XMM1);
+			andf(XMM3, xra, signMask());
+			op_orf(XMM0, XMM3);
+
+			andf(XMM2, xra, absMask());
+			loadfv(XMM3, m_single ? 0x1p23 : 0x1p52);
+			op_cmpf(XMM2, XMM3);
+			value<uint8_t>(5);						// not |x| < 2^52, NaN included
+			op_andf(xra, XMM2);
+			op_andnf(XMM2, XMM0);
+			op_orf(xra, XMM2);
+			restoreArguments();
+		}
+
+		// xra = ceil(xra), -floor(-xra) without SSE4.1.
+		void ceilf(uint32_t xra) {
+			if (m_features.avx || m_features.sse41) {
+				roundsf(xra, xra, 10);
+			}
+			else {
+				negf(xra);
+				floorf(xra);
+				negf(xra);
+			}
+		}
+
+		// sin/cos use XMM0-XMM3 as temporaries, float arguments passed in them are kept on the stack meanwhile.
+		void saveArguments() {
+			for (size_t a = 0; a < m_arguments.size(); ++a) {
+				if (m_arguments[a] != DataType::Integer && argumentRegister(a) <= XMM3) pushf(argumentRegister(a));
+			}
+		}
+		void restoreArguments() {
+			for (size_t a = m_arguments.size(); a-- > 0;) {
+				if (m_arguments[a] != DataType::Integer && argumentRegister(a) <= XMM3) popf(argumentRegister(a));
+			}
+		}
+
+		// Minimax kernels for [-pi/4, pi/4] from fdlibm, highest degree first.
+		// sin r = r + r z (S1 + z (S2 + ...)), cos r = 1 - z / 2 + z z (C1 + z (C2 + ...)), z = r^2.
+		constexpr static double sinKernel[6] {
+			1.58969099521155010221e-10, -2.50507602534068634195e-08, 2.75573137070700676789e-06,
+			-1.98412698298579493134e-04, 8.33333333332248946124e-03, -1.66666666666666324348e-01
+		};
+		constexpr static double cosKernel[6] {
+			-1.13596475577881948265e-11, 2.08757232129817482790e-09, -2.75573143513906633035e-07,
+			2.48015872894767294178e-05, -1.38888888888741095749e-03, 4.16666666666666019037e-02
+		};
+		// pi/2 in 33-bit parts, q * part is exact for |q| < 2^20 (Cody-Waite). Single uses 17-bit parts, exact for |q| < 2^7.
+		constexpr static double pio2Parts[3] { 1.57079632673412561417e+00, 6.07710050630396597660e-11, 2.02226624879595063154e-21 };
+		constexpr static double pio2PartsSingle[3] { 1.57078552246093750000e+00, 1.08042731881141662598e-05, 6.07710062827671038121e-11 };
+		// Beyond this the reduction is not attempted, x is made NaN and so are the results.
+		constexpr static double trigRange = 0x1p20 * std::numbers::pi / 2;
+
+		// Kernel terms used: fewer for Single, whose rounding hides the higher ones.
+		size_t sinTerms(bool fast) const noexcept {
+			return m_single ? ( fast ? 3 : 4 ) : fast ? 4 : 6;
+		}
+		size_t cosTerms(bool fast) const noexcept {
+			return m_single ? 3 : fast ? 3 : 6;
+		}
+
+		// Two independent Horner chains, a = ca[0] z^(na-1) + ... + ca[na-1] and b likewise, z in XMM2.
+		// Their steps are interleaved so the multiply and add latencies of one chain hide behind the other;
+		// the shorter chain starts later so both end together. Coefficients come from the constant pool.
+		void horner2(uint32_t a, const double* ca, size_t na, uint32_t b, const double* cb, size_t nb) {
+			size_t n = std::max(na, nb);
+			for (size_t k = 0; k < n; ++k) {
+				bool runA = k + na >= n, runB = k + nb >= n;
+				size_t ja = k + na - n, jb = k + nb - n;
+				if (runA && ja == 0) loadfv(a, ca[0]);
+				if (runB && jb == 0) loadfv(b, cb[0]);
+				if (runA && ja > 0) mulAddf(a, XMM2, pool(ca[ja]));
+				if (runB && jb > 0) mulAddf(b, XMM2, pool(cb[jb]));
+			}
+		}
+
+		// Reduces xra to r = x - q pi/2, |r| <= pi/4, and evaluates both kernels at r:
+		// sin r to XMM1, cos r to xrt, q to RAX. Clobbers xra, XMM0-XMM3 and R11.
+		// The fast tier drops the last reduction part, the highest terms and the rounding compensation of cos.
+		void trigKernels(uint32_t xra, uint32_t xrt) {
+			bool fast = m_options.trigAccuracy == TrigAccuracy::Fast;
+
+			andf(XMM3, xra, absMask());
+			loadfv(XMM0, trigRange);
+			cmpf(XMM3, XMM3, XMM0, 6);				// not |x| <= trigRange, NaN included
+			orf(xra, xra, XMM3);
+
+			mulf(XMM0, xra, pool(2.0 / std::numbers::pi));
+			roundNearestf(XMM0, XMM0);
+			addf(XMM0, XMM0, pool(0.0));			// q = -0 would make r = +0 for x = -0
+			op_ftoi(RAX, XMM0);
+			for (size_t p = 0; p < ( fast ? 2 : 3 ); ++p) {
+				mulSubf(xra, XMM0, pool(( m_single ? pio2PartsSingle : pio2Parts )[p]), XMM1);
+			}
+			mulf(XMM2, xra, xra);					// z
+
+			size_t ns = sinTerms(fast), nc = cosTerms(fast);
+			horner2(XMM1, sinKernel + 6 - ns, ns, XMM0, cosKernel + 6 - nc, nc);
+			mulf(XMM1, XMM1, XMM2);
+			mulf(XMM0, XMM0, XMM2);
+			mulf(XMM1, XMM1, xra);
+			addf(XMM1, XMM1, xra);					// sin r
+			andf(XMM1, XMM1, absMask());
+			andf(XMM3, xra, signMask());
+			orf(XMM1, XMM1, XMM3);					// with the sign of r, which the sum loses for r = -0
+
+			mulf(XMM0, XMM0, XMM2);					// z z (C1 + ...)
+			mulf(XMM3, XMM2, pool(0.5));				// hz = z / 2
+			genf1(xrt);
+			subf(xrt, xrt, XMM3);					// w = 1 - hz
+			if (!fast) {
+				genf1(XMM2);
+				subf(XMM2, XMM2, xrt);
+				subf(XMM2, XMM2, XMM3);
+				addf(XMM0, XMM0, XMM2);				// + (1 - w) - hz, lost when rounding w
+			}
+			addf(xrt, xrt, XMM0);					// cos r
+		}
+
+		// dst = sin(x + quadrant pi/2) from trigKernels' results, without branches:
+		// odd quadrants take cos r instead of sin r, quadrants 2 and 3 flip the sign. Clobbers XMM0, XMM3 and R11.
+		void trigSelect(uint32_t dst, uint32_t xrt, int32_t quadrant) {
+			op_movri(R11, RAX);
+			if (quadrant) addi(R11, quadrant);
+			andi(R11, 1);
+			op_negri(R11);
+			op_loadf(XMM0, R11);						// all ones for odd quadrants
+			andnf(XMM3, XMM0, XMM1);
+			andf(XMM0, XMM0, xrt);
+			orf(XMM0, XMM0, XMM3);
+
+			op_movri(R11, RAX);
+			if (quadrant) addi(R11, quadrant);
+			andi(R11, 2);
+			op_shlvi(R11);
+			value<uint8_t>(m_single ? 30 : 62);
+			op_loadf(XMM3, R11);						// sign bit for quadrants 2 and 3
+			xorf(dst, XMM0, XMM3);
+		}
+
+		// xrs = sin x, xrc = cos x with x in xrs, one reduction and kernel evaluation for both.
+		void sinCos(uint32_t xrs, uint32_t xrc) {
+			if (m_options.trigAccuracy == TrigAccuracy::Strict) {
+				op_movf(xrc, xrs);
+				callFloat(xrs, strictSin, xrc);
+				callFloat(xrc, strictCos, xrs);
+				return;
+			}
+			uint32_t xrt = scratchf(xrs);
+			saveArguments();
+			trigKernels(xrs, xrt);
+			trigSelect(xrs, xrt, 0);
+			trigSelect(xrc, xrt, 1);				// xrc may be xrt, which is read before the final move
+			restoreArguments();
+		}
+
+		void trig(uint32_t xra, int32_t quadrant) {
+			if (m_options.trigAccuracy == TrigAccuracy::Strict) {
+				callFloat(xra, quadrant ? strictCos : strictSin);
+				return;
+			}
+			uint32_t xrt = scratchf(xra);
+			saveArguments();
+			trigKernels(xra, xrt);
+			trigSelect(xra, xrt, quadrant);
+			restoreArguments();
+		}
+
+		// Packed counterparts of the helpers above for the loops of batch kernels, on whole registers:
+		// 256-bit VEX forms with AVX, the SSE2 forms otherwise. Without AVX dst may be b only if the operation commutes.
+		void pop(Instruction& sse, Instruction& avx, uint32_t dst, uint32_t a, uint32_t b, bool commutes = true) {
+			if (m_features.avx) {
+				avx(dst, a, b);
+				return;
+			}
+			if (dst == b && dst != a) {
+				if (!commutes) throw BadOpcodeException();
+				std::swap(a, b);
+			}
+			movp(dst, a);
+			sse(dst, b);
+		}
+		void pop(Instruction& sse, Instruction& avx, uint32_t dst, uint32_t a, Mem b) {
+			if (m_features.avx) {
+				avx(dst, a, b);
+				return;
+			}
+			movp(dst, a);
+			sse(dst, b);
+		}
+		void movp(uint32_t dst, uint32_t src) {
+			if (dst == src) return;
+			if (m_features.avx) op_vmovap(dst, 0, src);
+			else op_movapd(dst, src);
+		}
+		void loadp(uint32_t dst, Mem src) {
+			if (m_features.avx) op_vmovp(dst, 0, src);
+			else op_movupd(dst, src);
+		}
+		void storep(uint32_t src, Mem dst) {
+			if (m_features.avx) op_vmovmp(src, 0, dst);
+			else op_movmupd(src, dst);
+		}
+
+		// Moves of 4, 8, 16 or 32 bytes whatever the precision, for columns of either element size.
+		// VEX forms while the upper halves may be in use (packed AVX loops and those nested in them), legacy ones elsewhere.
+		void loadBytes(uint32_t reg, Mem src, uint32_t bytes) {
+			bool vex = m_upperDirty;
+			switch (bytes) {
+				case 4: vex ? op_vmovss(reg, 0, src) : op_movss(reg, src); break;
+				case 8: vex ? op_vmovsd(reg, 0, src) : op_movsd(reg, src); break;
+				case 16: vex ? op_vmovups(reg, 0, src) : op_movups(reg, src); break;
+				default: op_vmovups256(reg, 0, src); break;
+			}
+		}
+		void storeBytes(uint32_t reg, Mem dst, uint32_t bytes) {
+			bool vex = m_upperDirty;
+			switch (bytes) {
+				case 4: vex ? op_vmovmss(reg, 0, dst) : op_movmss(reg, dst); break;
+				case 8: vex ? op_vmovmsd(reg, 0, dst) : op_movmsd(reg, dst); break;
+				case 16: vex ? op_vmovmups(reg, 0, dst) : op_movmups(reg, dst); break;
+				default: op_vmovmups256(reg, 0, dst); break;
+			}
+		}
+		// Element of FLoadM and FStoreM: IMM holds its offset, size and the stride of the lanes.
+		Mem element(const ir::Instruction& i) const {
+			return { reg(i.operands[1].reg), (int32_t)(uint32_t)i.operands[2].value };
+		}
+		static uint32_t elementSize(const ir::Instruction& i) noexcept {
+			return (uint32_t)( i.operands[2].value >> 32 & 0xff );
+		}
+		static uint32_t elementStride(const ir::Instruction& i) noexcept {
+			uint32_t stride = (uint32_t)( i.operands[2].value >> 40 );
+			return stride ? stride : elementSize(i);
+		}
+		// Lanes of reg from size-byte elements stride bytes apart. With AVX the upper half is put together in XMM0,
+		// Single lanes without SSE4.1 in XMM0 and XMM1.
+		void gather(uint32_t reg, Mem src, uint32_t size, uint32_t stride) {
+			size_t half = 16 / size;
+			for (size_t first = 0; first < m_lanes; first += half) {
+				auto at = [&](size_t lane) { return Mem { src.base, src.disp + (int32_t)( ( first + lane ) * stride ) }; };
+				size_t count = std::min(half, m_lanes - first);
+				uint32_t dst = first == 0 ? reg : XMM0;
+				loadBytes(dst, at(0), size);
+				if (size == 8) m_features.avx ? op_vmovhpd(dst, dst, at(1)) : op_movhpd(dst, at(1));
+				else if (m_features.avx || m_features.sse41) {
+					for (size_t k = 1; k < count; ++k) {
+						m_features.avx ? op_vinsertps(dst, dst, at(k)) : op_insertps(dst, at(k));
+						value<uint8_t>((uint8_t)( k << 4 ));
+					}
+				}
+				else {
+					op_movss(XMM0, at(1));
+					op_unpcklps(dst, XMM0);
+					if (count == 4) {
+						op_movss(XMM0, at(2));
+						op_movss(XMM1, at(3));
+						op_unpcklps(XMM0, XMM1);
+						op_movlhps(dst, XMM0);
+					}
+				}
+				if (first > 0) {
+					op_vinsertf128(reg, reg, XMM0);
+					value<uint8_t>(1);
+				}
+			}
+		}
+		// Lanes of reg to size-byte elements stride bytes apart. With AVX the upper half goes through XMM0,
+		// Single lanes through it as well without SSE4.1.
+		void scatter(uint32_t reg, Mem dst, uint32_t size, uint32_t stride) {
+			size_t half = 16 / size;
+			uint32_t src = reg;
+			for (size_t lane = 0; lane < m_lanes; ++lane) {
+				Mem at { dst.base, dst.disp + (int32_t)( lane * stride ) };
+				uint8_t k = (uint8_t)( lane % half );
+				if (lane == half) {
+					op_vextractf128(reg, 0, XMM0);
+					value<uint8_t>(1);
+					src = XMM0;
+				}
+				if (k == 0) storeBytes(src, at, size);
+				else if (size == 8) m_features.avx ? op_vmovmhpd(src, 0, at) : op_movmhpd(src, at);
+				else if (m_features.avx || m_features.sse41) {
+					m_features.avx ? op_vextractps(src, 0, at) : op_extractps(src, at);
+					value<uint8_t>(k);
+				}
+				else {
+					op_pshufd(XMM0, src);
+					value<uint8_t>(k);
+					op_movmss(XMM0, at);
+				}
+			}
+		}
+		void addp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_addp, op_vaddp, dst, a, b); }
+		void subp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_subp, op_vsubp, dst, a, b, false); }
+		void mulp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_mulp, op_vmulp, dst, a, b); }
+		void divp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_divp, op_vdivp, dst, a, b, false); }
+		void andp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_andf, op_vandp, dst, a, b); }
+		void andnp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_andnf, op_vandnp, dst, a, b, false); }
+		void orp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_orf, op_vorp, dst, a, b); }
+		void xorp(uint32_t dst, uint32_t a, uint32_t b) { pop(op_xorf, op_vxorp, dst, a, b); }
+		void addp(uint32_t dst, uint32_t a, Mem b) { pop(op_addp, op_vaddp, dst, a, b); }
+		void subp(uint32_t dst, uint32_t a, Mem b) { pop(op_subp, op_vsubp, dst, a, b); }
+		void mulp(uint32_t dst, uint32_t a, Mem b) { pop(op_mulp, op_vmulp, dst, a, b); }
+		void divp(uint32_t dst, uint32_t a, Mem b) { pop(op_divp, op_vdivp, dst, a, b); }
+		void andp(uint32_t dst, uint32_t a, Mem b) { pop(op_andf, op_vandp, dst, a, b); }
+		void xorp(uint32_t dst, uint32_t a, Mem b) { pop(op_xorf, op_vxorp, dst, a, b); }
+		// dst = a predicate b ? ~0 : 0 per lane (0 equal, 1 less, 4 not equal, 6 not less or equal).
+		void cmpp(uint32_t dst, uint32_t a, uint32_t b, uint8_t predicate) {
+			pop(op_cmpp, op_vcmpp, dst, a, b, false);
+			value<uint8_t>(predicate);
+		}
+
+		// reg = reg * a + b, fused with FMA.
+		void mulAddp(uint32_t reg, uint32_t a, Mem b) {
+			if (m_features.fma) {
+				op_vfmadd213p(reg, a, b);
+				return;
+			}
+			mulp(reg, reg, a);
+			addp(reg, reg, b);
+		}
+		// reg = reg + a * b, fused with FMA. Clobbers tmp otherwise.
+		void addMulp(uint32_t reg, uint32_t a, Mem b, uint32_t tmp) {
+			if (m_features.fma) {
+				op_vfmadd231p(reg, a, b);
+				return;
+			}
+			mulp(tmp, a, b);
+			addp(reg, reg, tmp);
+		}
+		// reg = reg - a * b, fused with FMA. Clobbers tmp otherwise.
+		void mulSubp(uint32_t reg, uint32_t a, Mem b, uint32_t tmp) {
+			if (m_features.fma) {
+				op_vfnmadd231p(reg, a, b);
+				return;
+			}
+			mulp(tmp, a, b);
+			subp(reg, reg, tmp);
+		}
+
+		// Copies the low lane of reg, of size bytes, to the others.
+		void broadcastp(uint32_t reg, uint32_t size) {
+			if (size == 4) {
+				if (m_features.avx) {
+					op_vshufps(reg, reg, reg);
+					value<uint8_t>(0);
+					op_vinsertf128(reg, reg, reg);
+					value<uint8_t>(1);
+				}
+				else {
+					op_shufps(reg, reg);
+					value<uint8_t>(0);
+				}
+				return;
+			}
+			if (m_features.avx) {
+				op_vunpcklp(reg, reg, reg);
+				op_vinsertf128(reg, reg, reg);
+				value<uint8_t>(1);
+			}
+			else {
+				op_unpcklp(reg, reg);
+			}
+		}
+
+		// reg rounded with roundpd's mode (8 nearest, 9 down, 10 up), with SSE4.1 or AVX.
+		void roundp(uint32_t reg, uint8_t mode) {
+			if (m_features.avx) ( m_single ? op_vroundp32 : op_vroundp )(reg, 0, reg);
+			else ( m_single ? op_roundp32 : op_roundp )(reg, reg);
+			value<uint8_t>(mode);
+		}
+		// reg = reg rounded to nearest. SSE2 adds and subtracts 1.5 * 2^52, exact for |reg| < 2^51
+		// (1.5 * 2^23 and 2^22 for Single).
+		void roundNearestp(uint32_t reg) {
+			if (m_features.avx || m_features.sse41) {
+				roundp(reg, 8);
+				return;
+			}
+			double bias = m_single ? 0x1.8p23 : 0x1.8p52;
+			addp(reg, reg, pool(bias));
+			subp(reg, reg, pool(bias));
+		}
+
+		// xra = floor(xra). The SSE2 fallback rounds to nearest, subtracts 1 where that rounded up and keeps
+		// the sign of -0; |x| >= 2^51 are integral already and kept. Clobbers XMM0-XMM2.
+		void floorp(uint32_t xra) {
+			if (m_features.avx || m_features.sse41) {
+				roundp(xra, 9);
+				return;
+			}
+			movp(XMM0, xra);
+			roundNearestp(XMM0);
+			cmpp(XMM1, xra, XMM0, 1);				// x < round x
+			andp(XMM1, XMM1, pool(1.0));
+			subp(XMM0, XMM0, XMM1);
+			andp(XMM1, xra, signMask());
+			orp(XMM0, XMM0, XMM1);
+
+			andp(XMM1, xra, absMask());
+			loadp(XMM2, pool(m_single ? 0x1p22 : 0x1p51));
+			cmpp(XMM2, XMM2, XMM1, 2);				// 2^51 <= |x|
+			andp(xra, xra, XMM2);
+			andnp(XMM2, XMM2, XMM0);
+			orp(xra, xra, XMM2);
+		}
+
+		void ceilp(uint32_t xra) {
+			if (m_features.avx || m_features.sse41) {
+				roundp(xra, 10);
+				return;
+			}
+			xorp(xra, xra, signMask());
+			floorp(xra);
+			xorp(xra, xra, signMask());
+		}
+
+		void horner2p(uint32_t a, const double* ca, size_t na, uint32_t b, const double* cb, size_t nb) {
+			size_t n = std::max(na, nb);
+			for (size_t k = 0; k < n; ++k) {
+				bool runA = k + na >= n, runB = k + nb >= n;
+				size_t ja = k + na - n, jb = k + nb - n;
+				if (runA && ja == 0) loadp(a, pool(ca[0]));
+				if (runB && jb == 0) loadp(b, pool(cb[0]));
+				if (runA && ja > 0) mulAddp(a, XMM2, pool(ca[ja]));
+				if (runB && jb > 0) mulAddp(b, XMM2, pool(cb[jb]));
+			}
+		}
+
+		// trigKernels on every lane: sin r to XMM1, cos r to xrt, and the quadrant m = q - 4 round(q / 4), in -2..2,
+		// pushed to the stack for trigSelectp, which pops it. Clobbers xra and XMM0-XMM3.
+		void trigKernelsp(uint32_t xra, uint32_t xrt) {
+			bool fast = m_options.trigAccuracy == TrigAccuracy::Fast;
+
+			andp(XMM3, xra, absMask());
+			loadp(XMM0, pool(trigRange));
+			cmpp(XMM3, XMM3, XMM0, 6);
+			orp(xra, xra, XMM3);
+
+			mulp(XMM0, xra, pool(2.0 / std::numbers::pi));
+			roundNearestp(XMM0);
+			addp(XMM0, XMM0, pool(0.0));
+			for (size_t p = 0; p < ( fast ? 2 : 3 ); ++p) {
+				mulSubp(xra, XMM0, pool(( m_single ? pio2PartsSingle : pio2Parts )[p]), XMM1);
+			}
+			mulp(XMM1, XMM0, pool(0.25));
+			roundNearestp(XMM1);
+			mulp(XMM1, XMM1, pool(4.0));
+			subp(XMM0, XMM0, XMM1);
+			subi(RSP, 32);
+			storep(XMM0, Mem { RSP, 0 });
+			mulp(XMM2, xra, xra);					// z
+
+			size_t ns = sinTerms(fast), nc = cosTerms(fast);
+			horner2p(XMM1, sinKernel + 6 - ns, ns, XMM0, cosKernel + 6 - nc, nc);
+			mulp(XMM1, XMM1, XMM2);
+			mulp(XMM0, XMM0, XMM2);
+			mulp(XMM1, XMM1, xra);
+			addp(XMM1, XMM1, xra);					// sin r
+			andp(XMM1, XMM1, absMask());
+			andp(XMM3, xra, signMask());
+			orp(XMM1, XMM1, XMM3);
+
+			mulp(XMM0, XMM0, XMM2);					// z z (C1 + ...)
+			mulp(XMM3, XMM2, pool(0.5));			// hz
+			loadp(xrt, pool(1.0));
+			subp(xrt, xrt, XMM3);					// w = 1 - hz
+			if (!fast) {
+				loadp(XMM2, pool(1.0));
+				subp(XMM2, XMM2, xrt);
+				subp(XMM2, XMM2, XMM3);
+				addp(XMM0, XMM0, XMM2);
+			}
+			addp(xrt, xrt, XMM0);					// cos r
+		}
+
+		// trigSelect with lane masks from m: odd quadrants take cos r, quadrants 2 and 3 (m + quadrant
+		// below -0.5 or above 1.5) flip the sign. Clobbers XMM0, XMM2 and XMM3; dst may be xrt.
+		void trigSelectp(uint32_t dst, uint32_t xrt, int32_t quadrant, bool last) {
+			loadp(XMM0, Mem { RSP, 0 });
+			if (last) addi(RSP, 32);
+			if (quadrant) addp(XMM0, XMM0, pool(quadrant));
+			mulp(XMM2, XMM0, pool(0.5));
+			roundNearestp(XMM2);
+			mulp(XMM2, XMM2, pool(-2.0));
+			addp(XMM2, XMM2, XMM0);					// -1, 0 or 1: parity
+			xorp(XMM3, XMM3, XMM3);
+			cmpp(XMM2, XMM2, XMM3, 4);				// odd
+			andnp(XMM3, XMM2, XMM1);
+			andp(XMM2, XMM2, xrt);
+			orp(XMM2, XMM2, XMM3);
+
+			loadp(XMM3, pool(-0.5));
+			cmpp(XMM3, XMM3, XMM0, 6);				// m < -0.5
+			loadp(dst, pool(1.5));
+			cmpp(dst, dst, XMM0, 1);				// 1.5 < m
+			orp(dst, dst, XMM3);
+			andp(dst, dst, signMask());
+			xorp(dst, dst, XMM2);
+		}
+
+		void trigp(uint32_t xra, int32_t quadrant) {
+			uint32_t xrt = scratchf(xra);
+			trigKernelsp(xra, xrt);
+			trigSelectp(xra, xrt, quadrant, true);
+		}
+
+		void sinCosp(uint32_t xrs, uint32_t xrc) {
+			uint32_t xrt = scratchf(xrs);
+			trigKernelsp(xrs, xrt);
+			trigSelectp(xrs, xrt, 0, false);
+			trigSelectp(xrc, xrt, 1, true);
+		}
+
+		// r0 = r0 / r1 or r0 % r1, truncating like C. RDX may hold an argument and is kept in R11 meanwhile.
+		void divide(uint32_t r0, uint32_t r1, bool remainder) {
+			op_movri(RAX, r0);
+			op_movri(R11, RDX);
+			op_cqo();
+			op_divri(r1);
+			op_movri(r0, remainder ? RDX : RAX);
+			op_movri(RDX, R11);
+		}
+
+		struct DivisionMagic {
+			int64_t multiplier;
+			uint32_t shift;
+		};
+
+		// Multiplier and shift replacing signed division by d, |d| >= 2 and not a power of two
+		// (Hacker's Delight, 10-1): q = (mulhi(x, M) +- x) >> s, plus one if negative.
+		static DivisionMagic divisionMagic(int64_t d) noexcept {
+			constexpr uint64_t two63 = 1ull << 63;
+			uint64_t ad = d < 0 ? 0 - (uint64_t)d : (uint64_t)d;
+			uint64_t t = two63 + ( (uint64_t)d >> 63 );
+			uint64_t anc = t - 1 - t % ad;
+			uint64_t q1 = two63 / anc, r1 = two63 - q1 * anc;
+			uint64_t q2 = two63 / ad, r2 = two63 - q2 * ad;
+			uint32_t p = 63;
+			uint64_t delta;
+			do {
+				++p;
+				q1 *= 2; r1 *= 2;
+				if (r1 >= anc) { ++q1; r1 -= anc; }
+				q2 *= 2; r2 *= 2;
+				if (r2 >= ad) { ++q2; r2 -= ad; }
+				delta = ad - r2;
+			} while (q1 < delta || q1 == delta && r1 == 0);
+			uint64_t m = q2 + 1;
+			return { (int64_t)( d < 0 ? 0 - m : m ), p - 64 };
+		}
+
+		// r0 = r0 / d or r0 % d for a literal d without idiv: shifts for powers of two,
+		// a multiply-high otherwise. 0 and INT64_MIN keep the generic path.
+		void divideBy(uint32_t r0, int64_t d, bool remainder) {
+			if (d == 0 || d == INT64_MIN) {
+				movi(R10, d);
+				divide(r0, R10, remainder);
+				return;
+			}
+			if (d == 1 || d == -1) {
+				if (remainder) op_xorri(r0, r0);
+				else if (d == -1) op_negri(r0);
+				return;
+			}
+
+			uint64_t ad = d < 0 ? 0 - (uint64_t)d : (uint64_t)d;
+			if (( ad & ( ad - 1 ) ) == 0) {
+				// Negative dividends are biased by |d| - 1 so the shift truncates towards zero.
+				uint8_t k = (uint8_t)std::countr_zero(ad);
+				op_movri(R11, r0);
+				op_sarvi(R11);
+				value<uint8_t>(63);
+				op_shrvi(R11);
+				value<uint8_t>(64 - k);
+				op_addri(R11, r0);
+				op_sarvi(R11);
+				value<uint8_t>(k);
+				if (remainder) {
+					op_shlvi(R11);
+					value<uint8_t>(k);
+					op_subri(r0, R11);
+				}
+				else {
+					if (d < 0) op_negri(R11);
+					op_movri(r0, R11);
+				}
+				return;
+			}
+
+			DivisionMagic magic = divisionMagic(d);
+			uint32_t x = r0;
+			if (x == RAX) {
+				op_movri(R10, RAX);
+				x = R10;
+			}
+			op_movri(R11, RDX);
+			movi(RAX, magic.multiplier);
+			op_imulr(x);
+			if (d > 0 && magic.multiplier < 0) op_addri(RDX, x);
+			if (d < 0 && magic.multiplier > 0) op_subri(RDX, x);
+			if (magic.shift > 0) {
+				op_sarvi(RDX);
+				value<uint8_t>((uint8_t)magic.shift);
+			}
+			op_movri(RAX, RDX);
+			op_shrvi(RAX);
+			value<uint8_t>(63);
+			op_addri(RDX, RAX);						// quotient
+			if (remainder) {
+				if (d >= INT32_MIN && d <= INT32_MAX) {
+					muli(RDX, (int32_t)d);
+				}
+				else {
+					movi(RAX, d);
+					op_mulri(RDX, RAX);
+				}
+				if (x != r0) op_movri(r0, x);
+				op_subri(r0, RDX);
+			}
+			else {
+				op_movri(r0, RDX);
+			}
+			op_movri(RDX, R11);
+		}
+
+		static double strictSin(double x) { return std::sin(x); }
+		static double strictCos(double x) { return std::cos(x); }
+
+		bool volatileRegister(uint32_t r, DataType type) const noexcept {
+			return !( ( type == DataType::Integer ? m_convention.calleeSavedIntegers : m_convention.calleeSavedFloats ) >> r & 1 );
+		}
+
+		// xra = fn(xra). Volatile registers that may hold live values (arguments, used pool registers and keep)
+		// are saved around the call, the stack is aligned and shadow space reserved as the convention requires.
+		void callFloat(uint32_t xra, double(*fn)(double), uint32_t keep = XMM0) {
+			std::vector<uint32_t> integers, floats;
+			for (size_t a = 0; a < m_arguments.size(); ++a) {
+				size_t count = m_arguments[a] == DataType::Integer ? m_convention.integerArgumentCount : m_convention.floatArgumentCount;
+				if (argumentSlot(a) >= count) continue;
+				if (m_arguments[a] == DataType::Integer) integers.push_back(argumentRegister(a));
+				else if (argumentRegister(a) != xra) floats.push_back(argumentRegister(a));
+			}
+			for (size_t n = 0; n < m_integerPool.size(); ++n) {
+				if (m_poolMask >> n & 1 && volatileRegister(m_integerPool[n], DataType::Integer)) integers.push_back(m_integerPool[n]);
+			}
+			for (size_t n = 0; n < m_floatPool.size(); ++n) {
+				if (m_poolMask >> ( 32 + n ) & 1 && volatileRegister(m_floatPool[n], DataType::Float) && m_floatPool[n] != xra) floats.push_back(m_floatPool[n]);
+			}
+			if (keep != XMM0 && keep != xra && volatileRegister(keep, DataType::Float) && std::find(floats.begin(), floats.end(), keep) == floats.end()) {
+				floats.push_back(keep);
+			}
+
+			uint32_t depth = 8 + (uint32_t)m_savedIntegers.size() * 8 + m_frameSize; // below the last 16-byte boundary
+			uint32_t size = m_convention.shadowSpace + (uint32_t)( integers.size() + floats.size() ) * 8;
+			size += ( 16 - ( depth + size ) % 16 ) % 16;
+			int32_t offset = (int32_t)m_convention.shadowSpace;
+
+			subi(RSP, (int32_t)size);
+			for (size_t n = 0; n < integers.size(); ++n) op_movmi(integers[n], Mem { RSP, offset + 8 * (int32_t)n });
+			for (size_t f = 0; f < floats.size(); ++f) op_movmsd(floats[f], Mem { RSP, offset + 8 * (int32_t)( integers.size() + f ) });
+
+			// fn takes and returns a double, Single values are converted.
+			if (m_single) op_cvtss2sd(XMM0, xra);
+			else if (xra != XMM0) op_movf(XMM0, xra);
+			op_movvi(RAX);
+			value<uint64_t>((uint64_t)fn);
+			op_callr(RAX);
+			if (m_single) op_cvtsd2ss(xra, XMM0);
+			else if (xra != XMM0) op_movf(xra, XMM0);
+
+			for (size_t f = 0; f < floats.size(); ++f) op_movsd(floats[f], Mem { RSP, offset + 8 * (int32_t)( integers.size() + f ) });
+			for (size_t n = 0; n < integers.size(); ++n) op_movri(integers[n], Mem { RSP, offset + 8 * (int32_t)n });
+			addi(RSP, (int32_t)size);
+		}
+
+		std::unordered_map<ir::VirtualRegister, uint32_t> regMap {
+			{ ir::VirtualRegister::I0, RAX	},
+			{ ir::VirtualRegister::I1, R10	},
+			{ ir::VirtualRegister::IR, RAX  },
+			{ ir::VirtualRegister::F0, m_convention.floatScratch[0]	},
+			{ ir::VirtualRegister::F1, m_convention.floatScratch[1]	},
+			{ ir::VirtualRegister::FR, XMM0 }
+		};
+
+		uint32_t reg(ir::VirtualRegister vr) const {
+			if (ir::isPoolRegister(vr)) {
+				return vr >= ir::VirtualRegister::PF0 ? m_floatPool.at(ir::poolIndex(vr)) : m_integerPool.at(ir::poolIndex(vr));
+			}
+			return regMap.at(vr);
+		}
+
+		// Slots are as wide as the registers of the widest packed loop.
+		Mem slot(uint64_t index) const noexcept {
+			return { RSP, (int32_t)( index * m_slotSize ) };
+		}
+
+		uint32_t scratchf(uint32_t busy) const noexcept {
+			return busy == m_convention.floatScratch[0] ? m_convention.floatScratch[1] : m_convention.floatScratch[0];
+		}
+
+		std::unordered_map<ir::Code, std::function<void(const ir::Instruction&)>> emitterMap {
+			{
+				ir::Code::Enter,
+				[this](const ir::Instruction& i) {
+					uint64_t mask = m_poolMask = i.operands[0].value;
+					m_savedIntegers.clear();
+					m_savedFloats.clear();
+					for (size_t n = 0; n < m_integerPool.size(); ++n) {
+						if (mask >> n & 1 && m_convention.calleeSavedIntegers >> m_integerPool[n] & 1) m_savedIntegers.push_back(m_integerPool[n]);
+					}
+					for (size_t n = 0; n < m_floatPool.size(); ++n) {
+						if (mask >> ( 32 + n ) & 1 && m_convention.calleeSavedFloats >> m_floatPool[n] & 1) m_savedFloats.push_back(m_floatPool[n]);
+					}
+
+					// Spill slots at [rsp], saved floats above them, rsp stays 16-byte aligned.
+					uint64_t lanes = i.operands[2].value;
+					m_slotSize = lanes > 1 ? (uint32_t)std::min<uint64_t>(8 * lanes, m_features.avx ? 32 : 16) : 8;
+					m_floatSaveOffset = (uint32_t)( ( i.operands[1].value * m_slotSize + 15 ) / 16 * 16 );
+					m_frameSize = m_floatSaveOffset + (uint32_t)m_savedFloats.size() * 16;
+					if (m_frameSize > 0 && m_savedIntegers.size() % 2 == 0) m_frameSize += 8;
+
+					for (uint32_t r : m_savedIntegers) op_pushi(r);
+					if (m_frameSize > 0) subi(RSP, (int32_t)m_frameSize);
+					for (size_t f = 0; f < m_savedFloats.size(); ++f) {
+						op_movmdqu(m_savedFloats[f], Mem { RSP, (int32_t)( m_floatSaveOffset + f * 16 ) });
+					}
+				}
+			},
+			{
+				ir::Code::Ret,
+				[this](const ir::Instruction&){
+					if (m_upperDirty) op_vzeroupper();
+					m_upperDirty = false;
+					for (size_t f = 0; f < m_savedFloats.size(); ++f) {
+						op_movdqu(m_savedFloats[f], Mem { RSP, (int32_t)( m_floatSaveOffset + f * 16 ) });
+					}
+					if (m_frameSize > 0) addi(RSP, (int32_t)m_frameSize);
+					for (size_t r = m_savedIntegers.size(); r-- > 0;) op_popi(m_savedIntegers[r]);
+					op_ret(); 
+				}
+			},
+			{
+				ir::Code::Loop,
+				[this](const ir::Instruction& i) {
+					m_lanes = (size_t)i.operands[0].value;
+					// Legacy SSE instructions after 256-bit ones are slow until the upper halves are cleared. Scalar loops
+					// nested in packed ones clear them too, the generator broadcasts the enclosing loop's values again after them.
+					if (m_lanes == 1 && m_upperDirty) {
+						op_vzeroupper();
+						m_upperDirty = false;
+					}
+					if (m_lanes > 1 && m_features.avx) m_upperDirty = true;
+					m_loops.push_back({ binary().size(), 0, m_lanes });
+				}
+			},
+			{
+				ir::Code::Precision,
+				[this](const ir::Instruction& i) {
+					m_single = i.operands[0].value == (uint64_t)DataType::Single;
+				}
+			},
+			{
+				ir::Code::LoopTest,
+				[this](const ir::Instruction& i) {
+					immediate(op_cmpvi8, op_cmpvi, reg(i.operands[0].reg), (int32_t)i.operands[1].value);
+					op_jl();
+					m_loops.back().exit = binary().size();
+					value<int32_t>(0);
+				}
+			},
+			{
+				ir::Code::LoopEnd,
+				[this](const ir::Instruction&) {
+					Loop loop = m_loops.back();
+					m_loops.pop_back();
+					op_jmp();
+					value<int32_t>((int32_t)( loop.head - ( binary().size() + 4 ) ));
+					int32_t exit = (int32_t)( binary().size() - ( loop.exit + 4 ) );
+					std::memcpy(binary().data() + loop.exit, &exit, sizeof(exit));
+					m_lanes = m_loops.empty() ? 1 : m_loops.back().lanes;
+					if (m_lanes > 1 && m_features.avx) m_upperDirty = true;
+				}
+			},
+			{
+				ir::Code::ILoadR,
+				[this](const ir::Instruction& i) {
+					movi(reg(i.operands[0].reg), (int64_t)i.operands[1].value);
+				}
+			},
+			{
+				ir::Code::IArgR,
+				[this](const ir::Instruction& i) {
+					uint32_t r = reg(i.operands[0].reg), a = argumentRegister(i.operands[1].value);
+					if (r != a) op_movri(r, a);
+				}
+			},
+			{
+				ir::Code::IBlockR,
+				[this](const ir::Instruction& i) {
+					if (m_arguments.empty() || m_arguments.back() != DataType::Integer) throw ArgumentRegisterException();
+					// Functions taking every integer argument register already get the block on the stack.
+					size_t block = m_arguments.size() - 1;
+					uint32_t r = reg(i.operands[0].reg);
+					if (!inRegister(block)) op_movri(r, stackArgument(block));
+					else if (r != argumentRegister(block)) op_movri(r, argumentRegister(block));
+				}
+			},
+			{
+				ir::Code::ISpill,
+				[this](const ir::Instruction& i) {
+					op_movmi(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::IFill,
+				[this](const ir::Instruction& i) {
+					op_movri(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::ILoadM,
+				[this](const ir::Instruction& i) {
+					op_movri(reg(i.operands[0].reg), Mem { reg(i.operands[1].reg), (int32_t)i.operands[2].value });
+				}
+			},
+			{
+				ir::Code::IStoreM,
+				[this](const ir::Instruction& i) {
+					op_movmi(reg(i.operands[0].reg), Mem { reg(i.operands[1].reg), (int32_t)i.operands[2].value });
+				}
+			},
+			{
+				ir::Code::ILoad,
+				[this](const ir::Instruction& i) {
+					int64_t v = (int64_t)i.operands[0].value;
+					if (v >= INT8_MIN && v <= INT8_MAX) {
+						op_pushvi8();
+						value<int8_t>((int8_t)v);
+					}
+					else if (v >= INT32_MIN && v <= INT32_MAX) {
+						op_pushvi();
+						value<int32_t>((int32_t)v);
+					}
+					else {
+						op_pushm(poolBits((uint64_t)v));
+					}
+				}
+			},
+			{
+				ir::Code::IArg,
+				[this](const ir::Instruction& i) {
+					op_pushi(argumentRegister(i.operands[0].value));
+				}
+			},
+			{
+				ir::Code::IPush,
+				[this](const ir::Instruction& i) {
+					op_pushi(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::IPop,
+				[this](const ir::Instruction& i) {
+					op_popi(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::IMov,
+				[this](const ir::Instruction& i) {
+					op_movri(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::IAdd,
+				[this](const ir::Instruction& i) {
+					op_addri(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::ISub,
+				[this](const ir::Instruction& i) {
+					op_subri(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::IMul,
+				[this](const ir::Instruction& i) {
+					op_mulri(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::IDiv,
+				[this](const ir::Instruction& i) {
+					divide(reg(i.operands[0].reg), reg(i.operands[1].reg), false);
+				}
+			},
+			{
+				ir::Code::IMod,
+				[this](const ir::Instruction& i) {
+					divide(reg(i.operands[0].reg), reg(i.operands[1].reg), true);
+				}
+			},
+			{
+				ir::Code::IAddI,
+				[this](const ir::Instruction& i) {
+					addi(reg(i.operands[0].reg), (int32_t)i.operands[1].value);
+				}
+			},
+			{
+				ir::Code::ISubI,
+				[this](const ir::Instruction& i) {
+					subi(reg(i.operands[0].reg), (int32_t)i.operands[1].value);
+				}
+			},
+			{
+				ir::Code::IMulI,
+				[this](const ir::Instruction& i) {
+					muli(reg(i.operands[0].reg), (int32_t)i.operands[1].value);
+				}
+			},
+			{
+				ir::Code::IDivI,
+				[this](const ir::Instruction& i) {
+					divideBy(reg(i.operands[0].reg), (int64_t)i.operands[1].value, false);
+				}
+			},
+			{
+				ir::Code::IModI,
+				[this](const ir::Instruction& i) {
+					divideBy(reg(i.operands[0].reg), (int64_t)i.operands[1].value, true);
+				}
+			},
+			{
+				ir::Code::ILea,
+				[this](const ir::Instruction& i) {
+					uint32_t r0 = reg(i.operands[0].reg), r1 = reg(i.operands[1].reg);
+					uint64_t address = i.operands[2].value;
+					op_lea(r0, Mem { r0, (int32_t)( address >> 32 ), r1, (uint32_t)( address & 0xFF ) });
+				}
+			},
+			{
+				ir::Code::INeg,
+				[this](const ir::Instruction& i) {
+					op_negri(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::IAbs,
+				[this](const ir::Instruction& i) {
+					uint32_t r0 = reg(i.operands[0].reg);
+					uint32_t r1 = r0 == RAX ? R10 : RAX;
+					op_movri(r1, r0);
+					op_sarvi(r1);
+					value<uint8_t>(63);
+					op_xorri(r0, r1);
+					op_subri(r0, r1);
+				}
+			},
+
+			{
+				ir::Code::FLoadR,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					if (i.operands[1].value == 0) xorf(xra, xra, xra);
+					else op_movf(xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FArgR,
+				[this](const ir::Instruction& i) {
+					uint32_t r = reg(i.operands[0].reg), a = argumentRegister(i.operands[1].value);
+					if (r != a) op_movf(r, a);
+				}
+			},
+			{
+				ir::Code::FSpill,
+				[this](const ir::Instruction& i) {
+					// Before packed loops values may be broadcast already, the whole register is kept.
+					if (m_slotSize > 8 && m_loops.empty()) storep(reg(i.operands[0].reg), slot(i.operands[1].value));
+					else op_movmf(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FFill,
+				[this](const ir::Instruction& i) {
+					if (m_slotSize > 8 && m_loops.empty()) loadp(reg(i.operands[0].reg), slot(i.operands[1].value));
+					else op_movf(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FLoad,
+				[this](const ir::Instruction& i) {
+					op_pushm(literal(i.operands[0].value));
+				}
+			},
+			{
+				ir::Code::FArg,
+				[this](const ir::Instruction& i) {
+					pushf(argumentRegister(i.operands[0].value));
+				}
+			},
+			{
+				ir::Code::FParamR,
+				[this](const ir::Instruction& i) {
+					Mem parameter { reg(i.operands[1].reg), (int32_t)( i.operands[2].value * sizeof(double) ) };
+					if (m_single) op_cvtsd2ss(reg(i.operands[0].reg), parameter);
+					else op_movf(reg(i.operands[0].reg), parameter);
+				}
+			},
+			{
+				ir::Code::FBroadcast,
+				[this](const ir::Instruction& i) {
+					broadcastp(reg(i.operands[0].reg), (uint32_t)i.operands[1].value);
+				}
+			},
+			{
+				ir::Code::FLoadM,
+				[this](const ir::Instruction& i) {
+					loadBytes(reg(i.operands[0].reg), element(i), elementSize(i));
+				}
+			},
+			{
+				ir::Code::FStoreM,
+				[this](const ir::Instruction& i) {
+					storeBytes(reg(i.operands[0].reg), element(i), elementSize(i));
+				}
+			},
+			{
+				ir::Code::FIota,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					xorf(xra, xra, xra);
+				}
+			},
+			{
+				ir::Code::FPush,
+				[this](const ir::Instruction& i) {
+					pushf(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FPop,
+				[this](const ir::Instruction& i) {
+					popf(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FMov,
+				[this](const ir::Instruction& i) {
+					op_movf(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FAdd,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					addf(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FSub,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					subf(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FMul,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					mulf(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FDiv,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					divf(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FAddK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					addf(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FMulK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					mulf(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FDivK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					divf(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FMulAddK,
+				[this](const ir::Instruction& i) {
+					mulAddf(reg(i.operands[0].reg), reg(i.operands[1].reg), literal(i.operands[2].value));
+				}
+			},
+			{
+				ir::Code::FMulKAdd,
+				[this](const ir::Instruction& i) {
+					// A scratch register other than the destination, at worst the filled copy of the factor.
+					uint32_t xra = reg(i.operands[0].reg);
+					addMulf(xra, reg(i.operands[1].reg), literal(i.operands[2].value), scratchf(xra));
+				}
+			},
+			{
+				ir::Code::FNeg,
+				[this](const ir::Instruction& i) {
+					negf(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FAbs,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					andf(xra, xra, absMask());
+				}
+			},
+			{
+				ir::Code::FFloor,
+				[this](const ir::Instruction& i) {
+					floorf(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FCeil,
+				[this](const ir::Instruction& i) {
+					ceilf(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FSin,
+				[this](const ir::Instruction& i) {
+					trig(reg(i.operands[0].reg), 0);
+				}
+			},
+			{
+				ir::Code::FCos,
+				[this](const ir::Instruction& i) {
+					trig(reg(i.operands[0].reg), 1);	// cos x = sin(x + pi/2)
+				}
+			},
+			{
+				ir::Code::FSinCos,
+				[this](const ir::Instruction& i) {
+					sinCos(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FToI,
+				[this](const ir::Instruction& i) {
+					op_ftoi(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::IToF,
+				[this](const ir::Instruction& i) {
+					op_itof(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::SToF,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					op_cvtss2sd(xra, xra);
+				}
+			},
+			{
+				ir::Code::FToS,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					op_cvtsd2ss(xra, xra);
+				}
+			}
+		};
+
+		// Float instructions inside packed loops, on every lane.
+		std::unordered_map<ir::Code, std::function<void(const ir::Instruction&)>> packedEmitterMap {
+			{
+				ir::Code::FLoadM,
+				[this](const ir::Instruction& i) {
+					uint32_t size = elementSize(i), stride = elementStride(i);
+					if (stride == size) loadBytes(reg(i.operands[0].reg), element(i), (uint32_t)m_lanes * size);
+					else gather(reg(i.operands[0].reg), element(i), size, stride);
+				}
+			},
+			{
+				ir::Code::FStoreM,
+				[this](const ir::Instruction& i) {
+					uint32_t size = elementSize(i), stride = elementStride(i);
+					if (stride == size) storeBytes(reg(i.operands[0].reg), element(i), (uint32_t)m_lanes * size);
+					else scatter(reg(i.operands[0].reg), element(i), size, stride);
+				}
+			},
+			{
+				ir::Code::FIota,
+				[this](const ir::Instruction& i) {
+					loadp(reg(i.operands[0].reg), iota());
+				}
+			},
+			{
+				ir::Code::SToF,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					if (m_features.avx) op_vcvtps2pd(xra, 0, xra);
+					else op_cvtps2pd(xra, xra);
+				}
+			},
+			{
+				ir::Code::FToS,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					if (m_features.avx) op_vcvtpd2ps(xra, 0, xra);
+					else op_cvtpd2ps(xra, xra);
+				}
+			},
+			{
+				ir::Code::FSpill,
+				[this](const ir::Instruction& i) {
+					storep(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FFill,
+				[this](const ir::Instruction& i) {
+					loadp(reg(i.operands[0].reg), slot(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FMov,
+				[this](const ir::Instruction& i) {
+					movp(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FAdd,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					addp(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FSub,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					subp(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FMul,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					mulp(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FDiv,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					divp(xra, xra, reg(i.operands[1].reg));
+				}
+			},
+			{
+				ir::Code::FAddK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					addp(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FMulK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					mulp(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FDivK,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					divp(xra, xra, literal(i.operands[1].value));
+				}
+			},
+			{
+				ir::Code::FMulAddK,
+				[this](const ir::Instruction& i) {
+					mulAddp(reg(i.operands[0].reg), reg(i.operands[1].reg), literal(i.operands[2].value));
+				}
+			},
+			{
+				ir::Code::FMulKAdd,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					addMulp(xra, reg(i.operands[1].reg), literal(i.operands[2].value), scratchf(xra));
+				}
+			},
+			{
+				ir::Code::FNeg,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					xorp(xra, xra, signMask());
+				}
+			},
+			{
+				ir::Code::FAbs,
+				[this](const ir::Instruction& i) {
+					uint32_t xra = reg(i.operands[0].reg);
+					andp(xra, xra, absMask());
+				}
+			},
+			{
+				ir::Code::FFloor,
+				[this](const ir::Instruction& i) {
+					floorp(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FCeil,
+				[this](const ir::Instruction& i) {
+					ceilp(reg(i.operands[0].reg));
+				}
+			},
+			{
+				ir::Code::FSin,
+				[this](const ir::Instruction& i) {
+					trigp(reg(i.operands[0].reg), 0);
+				}
+			},
+			{
+				ir::Code::FCos,
+				[this](const ir::Instruction& i) {
+					trigp(reg(i.operands[0].reg), 1);
+				}
+			},
+			{
+				ir::Code::FSinCos,
+				[this](const ir::Instruction& i) {
+					sinCosp(reg(i.operands[0].reg), reg(i.operands[1].reg));
+				}
+			}
+		};
+
+	public:
+		void operator()(const ir::Instruction& i) override {
+			if (m_lanes > 1) {
+				if (auto packed = packedEmitterMap.find(i.code); packed != packedEmitterMap.end()) {
+					packed->second(i);
+					return;
+				}
+			}
+			emitterMap.at(i.code)( i );
+		}
+
+		// Appends the constant pool 32-byte aligned and points the references at it.
+		void finalize() override {
+			if (m_constants.empty()) return;
+			while (binary().size() % 32 != 0) emit((uint8_t)0xCC);
+			size_t base = binary().size();
+			for (const auto& c : m_constants) {
+				for (uint64_t lane : c) value<uint64_t>(lane);
+			}
+			for (const ConstantReference& ref : m_constantReferences) {
+				int32_t disp = (int32_t)( base + ref.index * 32 - ( ref.position + 4 ) );
+				std::memcpy(binary().data() + ref.position, &disp, sizeof(disp));
+			}
+		}
+
+		// xmm or ymm registers. AVX-512 is not supported: there are no EVEX encodings, zmm code is never emitted.
+		size_t lanes() const noexcept override {
+			return m_features.avx ? 4 : 2;
+		}
+
+		size_t poolSize(DataType type) const noexcept override {
+			return type == DataType::Integer ? m_integerPool.size() : m_floatPool.size();
+		}
+
+		// Of the sequences emitted for each code on Skylake and Zen 2 class cores, rounded up; the two differ little
+		// for these except for idiv, where the older Intel cores are taken. Follows the fallbacks the features select.
+		unsigned latency(ir::Code code) const noexcept override {
+			switch (code) {
+				case ir::Code::IMul: case ir::Code::IMulI: case ir::Code::IAbs:
+					return 3;
+				case ir::Code::IDiv: case ir::Code::IMod:
+					return 42;
+				case ir::Code::IDivI: case ir::Code::IModI:
+					return 8;
+				case ir::Code::ILea:
+					return 2;
+				case ir::Code::FLoadR: case ir::Code::FFill: case ir::Code::FParamR: case ir::Code::FLoadM: case ir::Code::ILoadM: case ir::Code::FIota:
+					return 5;
+				case ir::Code::FAdd: case ir::Code::FSub: case ir::Code::FMul: case ir::Code::FAddK: case ir::Code::FMulK:
+					return 4;
+				case ir::Code::FDiv: case ir::Code::FDivK:
+					return 14;
+				case ir::Code::FMulAddK: case ir::Code::FMulKAdd:
+					return m_features.fma ? 4 : 8;
+				case ir::Code::IToF: case ir::Code::FToI:
+					return 6;
+				case ir::Code::SToF: case ir::Code::FToS:
+					return 4;
+				case ir::Code::FFloor: case ir::Code::FCeil:
+					return m_features.sse41 ? 8 : 30;
+				case ir::Code::FSin: case ir::Code::FCos:
+					return m_options.trigAccuracy == TrigAccuracy::Strict ? 80 : 50;
+				case ir::Code::FSinCos:
+					return m_options.trigAccuracy == TrigAccuracy::Strict ? 120 : 60;
+				default:
+					return 1;
+			}
+		}
+	};
 }
\ No newline at end of file
@@ -1,172 +1,417 @@
-#include "include/exprjit/ir_generator.h"
-#include <unordered_map>
-
-namespace exprjit::ir
-{
-	std::unordered_map<ExpressionNode::Binop, std::pair<Code, Code>> binopMap {
-		{ ExpressionNode::Binop::Add,		{ Code::IAdd, Code::FAdd } },
-		{ ExpressionNode::Binop::Subtract,	{ Code::ISub, Code::FSub } },
-		{ ExpressionNode::Binop::Multiply,	{ Code::IMul, Code::FMul } },
-		{ ExpressionNode::Binop::Divide,		{ Code::IDiv, Code::FDiv } },
-		{ ExpressionNode::Binop::Modulo,		{ Code::IMod, Code::FMod } }
-	};
-	std::unordered_map<ExpressionNode::Unop, std::pair<Code, Code>> unopMap {
-		{ ExpressionNode::Unop::Negate, { Code::INeg, Code::FNeg		} },
-		{ ExpressionNode::Unop::Abs,		{ Code::IAbs, Code::FAbs		} },
-		{ ExpressionNode::Unop::Sin,		{ Code::None, Code::FSin		} },
-		{ ExpressionNode::Unop::Cos,		{ Code::None, Code::FCos		} },
-		{ ExpressionNode::Unop::Floor,	{ Code::None, Code::FFloor	} },
-	};
-	VirtualRegister vri[2] { VirtualRegister::I0, VirtualRegister::I1 };
-	VirtualRegister vrf[2] { VirtualRegister::F0, VirtualRegister::F1 };
-
-	bool isInt(VirtualRegister vr) {
-		return vr == VirtualRegister::I0 || vr == VirtualRegister::I1;
-	}
-
-	void Generator::itof(VirtualRegister d, VirtualRegister i) noexcept {
-		Instruction instr(Code::IToF);
-		instr.operands[0] = d;
-		instr.operands[1] = i;
-		m_ir.push_back(instr);
-	}
-	void Generator::ftoi(VirtualRegister i, VirtualRegister d) noexcept {
-		Instruction instr(Code::FToI);
-		instr.operands[0] = i;
-		instr.operands[1] = d;
-		m_ir.push_back(instr);
-	}
-	void Generator::pop(VirtualRegister vr) noexcept {
-		Instruction popa(isInt(vr) ? Code::IPop : Code::FPop);
-		popa.operands[0] = vr;
-		m_ir.push_back(popa);
-	}
-	void Generator::push(VirtualRegister vr) noexcept {
-		Instruction pusha(isInt(vr) ? Code::IPush : Code::FPush);
-		pusha.operands[0] = vr;
-		m_ir.push_back(pusha);
-	}
-
-	VirtualRegister Generator::popa(DataType type, DataType resT, int reg) noexcept {
-		VirtualRegister V = type == DataType::Integer ? vri[reg] : vrf[reg];
-		pop(V);
-		if (type != resT) {
-			VirtualRegister Vn;
-			if(resT == DataType::Float) { 
-				Vn = vrf[reg];
-				itof(Vn, V);
-			}
-			else {
-				Vn = vri[reg];
-				ftoi(Vn, V);
-			}
-			V = Vn;
-		}
-		return V;
-	}
-
-	DataType Generator::gen(size_t i) noexcept {
-		auto& node = m_expression[i];
-
-		switch (node.type) {
-			case ExpressionNode::Type::Binop:
-			{
-				auto code = binopMap.at(node.binop.op);
-				DataType rhsT = gen(node.binop.rhs);
-				DataType lhsT = gen(node.binop.lhs);
-				DataType resT = ( lhsT == DataType::Float || rhsT == DataType::Float ) ? DataType::Float : DataType::Integer;
-				VirtualRegister lhsV = popa(lhsT, resT, 0);
-				VirtualRegister rhsV = popa(rhsT, resT, 1);
-				Instruction instr(resT == DataType::Integer ? code.first : code.second);
-				instr.operands[0] = lhsV;
-				instr.operands[1] = rhsV;
-				m_ir.push_back(instr);
-				push(lhsV);
-				return resT;
-			}
-			case ExpressionNode::Type::Unop:
-			{
-				DataType opT = gen(node.unop.operand);
-				if (node.unop.op == ExpressionNode::Unop::FToI) {
-					if (opT != DataType::Integer) {
-						pop(VirtualRegister::F0);
-						ftoi(VirtualRegister::I0, VirtualRegister::F0);
-						push(VirtualRegister::I0);
-					}
-					return DataType::Integer;
-				}
-				else if (node.unop.op == ExpressionNode::Unop::IToF) {
-					if (opT != DataType::Float) {
-						pop(VirtualRegister::I0);
-						itof(VirtualRegister::F0, VirtualRegister::I0);
-						push(VirtualRegister::F0);
-					}
-					return DataType::Float;
-				}
-				const auto& code = unopMap.at(node.unop.op);
-
-				DataType iT;
-				Code iC;
-				if (opT == DataType::Integer) {
-					if (code.first == Code::None) {
-						iT = DataType::Float;
-						iC = code.second;
-					}
-					else {
-						iT = DataType::Integer;
-						iC = code.first;
-					}
-				}
-				else {
-					if (code.second == Code::None) {
-						iT = DataType::Integer;
-						iC = code.first;
-					}
-					else {
-						iT = DataType::Float;
-						iC = code.second;
-					}
-				}
-
-				Instruction instr(iC);
-				VirtualRegister opV = popa(opT, iT, 0);
-				instr.operands[0] = opV;
-				m_ir.push_back(instr);
-				push(opV);
-				return iT;
-			}
-			case ExpressionNode::Type::Argument:
-			{
-				Instruction instr(node.argument.type == DataType::Integer ? Code::IArg : Code::FArg);
-				instr.operands[0] = node.argument.index;
-				m_ir.push_back(instr);
-				return node.argument.type;
-			}
-			case ExpressionNode::Type::Literal:
-			{
-				Instruction instr(node.literal.type == DataType::Integer ? Code::ILoad : Code::FLoad);
-				instr.operands[0] = node.literal.value;
-				m_ir.push_back(instr);
-				return node.literal.type;
-			}
-			default:
-				throw std::exception("Unknown expression node.");
-		}
-	}
-
-	void Generator::operator()() {
-		DataType returnType = gen(m_exprRoot);
-		if (returnType == m_resultType) {
-			pop(returnType == DataType::Integer ? VirtualRegister::IR : VirtualRegister::FR);
-		}
-		else if (returnType == DataType::Float && m_resultType == DataType::Integer) {
-			pop(VirtualRegister::F0);
-			ftoi(VirtualRegister::IR, VirtualRegister::F0);
-		}
-		else if (returnType == DataType::Integer && m_resultType == DataType::Float) {
-			pop(VirtualRegister::I0);
-			itof(VirtualRegister::FR, VirtualRegister::I0);
-		}
-		m_ir.push_back(Code::Ret);
-	}
-}
\ No newline at end of file
+#include "include/exprjit/ir_generator.h"
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <bit>
+
+namespace exprjit::ir
+{
+	static bool literal(const ValueGraph& graph, size_t v) noexcept {
+		return graph[v].code == Code::ILoadR || graph[v].code == Code::FLoadR;
+	}
+
+	static bool commutative(Code code) noexcept {
+		return code == Code::IAdd || code == Code::IMul || code == Code::FAdd || code == Code::FMul;
+	}
+
+	// Tiles packed batch loops may contain, besides the argument loads.
+	static bool packable(Code code, const CompileOptions& options) noexcept {
+		switch (code) {
+			case Code::FAdd: case Code::FSub: case Code::FMul: case Code::FDiv:
+			case Code::FAddK: case Code::FMulK: case Code::FDivK: case Code::FMulAddK: case Code::FMulKAdd:
+			case Code::FNeg: case Code::FAbs: case Code::FFloor: case Code::FCeil: case Code::SToF: case Code::FToS:
+				return true;
+			case Code::FSin: case Code::FCos:
+				return options.trigAccuracy != TrigAccuracy::Strict;
+			default:
+				return false;
+		}
+	}
+
+	static uint64_t elementSize(DataType type) noexcept {
+		return type == DataType::Single ? sizeof(float) : 8;
+	}
+
+	VirtualRegister Generator::allocate() noexcept {
+		return vreg(++m_registers); // V0 marks values not lowered yet
+	}
+
+	// Register of an operand that the instruction overwrites: copied while other uses remain.
+	VirtualRegister Generator::consume(const ValueGraph& graph, size_t v) {
+		VirtualRegister r = m_values[v];
+		if (--m_uses[v] == 0) return r;
+
+		VirtualRegister copy = allocate();
+		m_ir.push_back(Instruction(graph[v].type == DataType::Integer ? Code::IMov : Code::FMov, copy, r));
+		return copy;
+	}
+
+	void Generator::pairSinCos(const ValueGraph& graph) {
+		m_sinCos.assign(graph.size(), Value::None);
+		std::unordered_map<size_t, size_t> sines; // operand -> FSin value
+		for (size_t v = 0; v < graph.size(); ++v) {
+			if (graph[v].code == Code::FSin) sines.insert({ graph[v].operands[0], v });
+		}
+		for (size_t v = 0; v < graph.size(); ++v) {
+			if (graph[v].code != Code::FCos) continue;
+			auto sin = sines.find(graph[v].operands[0]);
+			if (sin == sines.end()) continue;
+			m_sinCos[v] = sin->second;
+			m_sinCos[sin->second] = v;
+		}
+	}
+
+	// Lowers both halves of a sin/cos pair at once: sin takes over the operand register, cos gets a new one.
+	VirtualRegister Generator::genSinCos(const ValueGraph& graph, size_t v) {
+		size_t sin = graph[v].code == Code::FSin ? v : m_sinCos[v], cos = m_sinCos[sin];
+		size_t operand = graph[v].operands[0];
+		gen(graph, operand);
+		--m_uses[operand];
+		VirtualRegister rs = consume(graph, operand);
+		VirtualRegister rc = allocate();
+		m_ir.push_back(Instruction(Code::FSinCos, rs, rc));
+		m_values[sin] = rs;
+		m_values[cos] = rc;
+		return m_values[v];
+	}
+
+	VirtualRegister Generator::gen(const ValueGraph& graph, size_t v) {
+		if (m_values[v] != Pending) return m_values[v];
+		if (m_sinCos[v] != Value::None) return genSinCos(graph, v);
+
+		const Tile& tile = m_tiles[v];
+		size_t lhs = tile.operands[0], rhs = tile.operands[1];
+		VirtualRegister r;
+		if (!m_columns.empty() && ( tile.code == Code::IArgR || tile.code == Code::FArgR )) {
+			r = allocate();
+			const Layout& layout = m_layouts[tile.immediate];
+			uint64_t offset = layout.offset + m_element * layout.stride;
+			if (tile.code == Code::IArgR) m_ir.push_back(Instruction(Code::ILoadM, r, m_columns[tile.immediate], offset));
+			else m_ir.push_back(Instruction(Code::FLoadM, r, m_columns[tile.immediate], offset | elementSize(graph[v].type) << 32 | (uint64_t)layout.stride << 40));
+		}
+		else if (lhs == Value::None) {
+			r = allocate();
+			m_ir.push_back(Instruction(tile.code, r, tile.immediate));
+		}
+		else if (operandInfo(tile.code)[0].access == Access::Def) {
+			VirtualRegister src = gen(graph, lhs);
+			--m_uses[lhs];
+			r = allocate();
+			m_ir.push_back(Instruction(tile.code, r, src, tile.immediate));
+		}
+		else if (rhs == Value::None) {
+			gen(graph, lhs);
+			r = consume(graph, lhs);
+			m_ir.push_back(Instruction(tile.code, r, tile.immediate));
+		}
+		else if (rhs == Tile::Same) {
+			gen(graph, lhs);
+			r = consume(graph, lhs);
+			m_ir.push_back(Instruction(tile.code, r, r, tile.immediate));
+		}
+		else {
+			// The operand needing more registers goes first, so the other one's result is held for less (Sethi-Ullman).
+			// Literals are loaded last, right before their use, and kept on the right of commutative
+			// operations, where Optimizer folds them into immediate forms.
+			if (commutative(tile.code) && literal(graph, lhs) && !literal(graph, rhs)) std::swap(lhs, rhs);
+			VirtualRegister rr;
+			if (m_need[lhs] > m_need[rhs] || ( m_need[lhs] == m_need[rhs] && literal(graph, rhs) )) {
+				gen(graph, lhs);
+				rr = gen(graph, rhs);
+			}
+			else {
+				rr = gen(graph, rhs);
+				gen(graph, lhs);
+			}
+			--m_uses[rhs];
+			r = consume(graph, lhs);
+			m_ir.push_back(Instruction(tile.code, r, rr, tile.immediate));
+		}
+		return m_values[v] = r;
+	}
+
+	// Registers each tile needs to be evaluated with its operands, as if they were not shared.
+	void Generator::number() {
+		m_need.assign(m_tiles.size(), 1);
+		for (size_t v = 0; v < m_tiles.size(); ++v) {
+			size_t lhs = m_tiles[v].operands[0], rhs = m_tiles[v].operands[1];
+			if (lhs == Value::None) continue;
+			if (rhs == Value::None || rhs == Tile::Same) m_need[v] = m_need[lhs];
+			else if (m_need[lhs] == m_need[rhs]) m_need[v] = m_need[lhs] + 1;
+			else m_need[v] = std::max(m_need[lhs], m_need[rhs]);
+		}
+	}
+
+	void Generator::prepare(const ValueGraph& graph) {
+		Selector selector(graph, m_options);
+		m_tiles = selector.tiles();
+		m_uses = selector.useCounts(graph.root());
+		number();
+		m_values.assign(graph.size(), Pending);
+		pairSinCos(graph);
+		m_columns.clear();
+	}
+
+	void Generator::operator()(const ValueGraph& graph) {
+		prepare(graph);
+		if (graph.precision() == DataType::Single) m_ir.push_back(Instruction(Code::Precision, (uint64_t)DataType::Single));
+		VirtualRegister result = gen(graph, graph.root());
+		if (graph[graph.root()].type == DataType::Integer) {
+			m_ir.push_back(Instruction(Code::IMov, VirtualRegister::IR, result));
+		}
+		else {
+			m_ir.push_back(Instruction(Code::FMov, VirtualRegister::FR, result));
+		}
+		m_ir.push_back(Code::Ret);
+	}
+
+	// Layout with the stride of elements of type filled in.
+	static Layout resolve(Layout layout, DataType type) {
+		if (layout.stride == 0) layout.stride = (uint32_t)elementSize(type);
+		if (layout.stride >= 1 << 24) throw std::invalid_argument("Layout stride is too large.");
+		return layout;
+	}
+
+	void Generator::batch(const ValueGraph& graph, size_t unroll, size_t lanes, const BatchLayout& layout) {
+		prepare(graph);
+		if (graph.precision() == DataType::Single) {
+			m_ir.push_back(Instruction(Code::Precision, (uint64_t)DataType::Single));
+			lanes *= 2;
+		}
+		VirtualRegister args = allocate(), out = allocate(), count = allocate();
+		m_ir.push_back(Instruction(Code::IArgR, args, 0));
+		m_ir.push_back(Instruction(Code::IArgR, out, 1));
+		m_ir.push_back(Instruction(Code::IArgR, count, 2));
+
+		// Column pointers of the arguments read, their layouts, and the values depending on them.
+		std::vector<bool> variant(graph.size(), false);
+		m_layouts.clear();
+		for (size_t v = 0; v < graph.size(); ++v) {
+			const Value& value = graph[v];
+			if (value.code == Code::IArgR || value.code == Code::FArgR) {
+				if (m_columns.size() <= value.immediate) {
+					m_columns.resize(value.immediate + 1, Pending);
+					m_layouts.resize(value.immediate + 1);
+				}
+				if (m_columns[value.immediate] == Pending) {
+					m_layouts[value.immediate] = resolve(value.immediate < layout.arguments.size() ? layout.arguments[value.immediate] : Layout {}, value.type);
+					m_columns[value.immediate] = allocate();
+					m_ir.push_back(Instruction(Code::ILoadM, m_columns[value.immediate], args, value.immediate * sizeof(void*)));
+				}
+				variant[v] = true;
+			}
+			for (size_t operand : value.operands) {
+				if (operand != Value::None && variant[operand]) variant[v] = true;
+			}
+		}
+		if (m_columns.empty()) m_columns.push_back(Pending); // batch mode with no arguments to read
+
+		// Invariant values read in the loop are computed here, and copied by each of their consumers.
+		constexpr size_t Shared = SIZE_MAX / 2;
+		size_t root = graph.root();
+		std::vector<size_t> uses = m_uses, hoisted;
+		for (size_t v = 0; v < graph.size(); ++v) {
+			if (!variant[v] || uses[v] == 0) continue;
+			for (size_t operand : m_tiles[v].operands) {
+				if (operand == Value::None || operand == Tile::Same || variant[operand] || m_uses[operand] == Shared) continue;
+				m_uses[operand] = Shared;
+				hoisted.push_back(operand);
+			}
+		}
+		if (!variant[root]) hoisted.push_back(root);
+		for (size_t v : hoisted) gen(graph, v);
+
+		// Float expressions the target evaluates lanes elements at a time take packed loops, invariants are
+		// broadcast to every lane for them. Elements left over go one by one.
+		bool integer = graph[root].type == DataType::Integer;
+		bool packed = lanes > 1 && !integer;
+		for (size_t v = 0; v < graph.size() && packed; ++v) {
+			if (variant[v] && uses[v] > 0 && graph[v].code != Code::FArgR && !packable(m_tiles[v].code, m_options)) packed = false;
+		}
+		if (packed) {
+			for (size_t v : hoisted) {
+				if (isFloat(graph[v].type)) m_ir.push_back(Instruction(Code::FBroadcast, m_values[v], elementSize(graph[v].type)));
+			}
+		}
+		else lanes = 1;
+
+		Layout result = resolve(layout.result, graph[root].type);
+		unroll = std::max(unroll, size_t(1));
+		std::vector<size_t> steps { unroll * lanes };
+		if (lanes > 1 && unroll > 1) steps.push_back(lanes);
+		if (steps.back() > 1) steps.push_back(1);
+		for (size_t step : steps) {
+			size_t width = step % lanes == 0 ? lanes : 1;
+			m_ir.push_back(Instruction(Code::Loop, width));
+			m_ir.push_back(Instruction(Code::LoopTest, count, step));
+			for (m_element = 0; m_element < step; m_element += width) {
+				for (size_t v = 0; v < graph.size(); ++v) {
+					if (!variant[v]) continue;
+					m_values[v] = Pending;
+					m_uses[v] = uses[v];
+				}
+				uint64_t offset = result.offset + m_element * result.stride;
+				if (integer) m_ir.push_back(Instruction(Code::IStoreM, gen(graph, root), out, offset));
+				else m_ir.push_back(Instruction(Code::FStoreM, gen(graph, root), out, offset | elementSize(graph[root].type) << 32 | (uint64_t)result.stride << 40));
+			}
+			for (size_t c = 0; c < m_columns.size(); ++c) {
+				if (m_columns[c] != Pending) m_ir.push_back(Instruction(Code::IAddI, m_columns[c], step * m_layouts[c].stride));
+			}
+			m_ir.push_back(Instruction(Code::IAddI, out, step * result.stride));
+			m_ir.push_back(Instruction(Code::ISubI, count, step));
+			m_ir.push_back(Code::LoopEnd);
+		}
+		m_element = 0;
+		m_columns.clear();
+		m_layouts.clear();
+		m_ir.push_back(Code::Ret);
+	}
+
+	void Generator::batch(size_t unroll, size_t lanes, const BatchLayout& layout) {
+		batch(ValueGraph(m_expression, m_exprRoot, m_resultType), unroll, lanes, layout);
+	}
+
+	void Generator::grid(const ValueGraph& graph, const Layout& layout, size_t unroll, size_t lanes) {
+		prepare(graph);
+		DataType precision = graph.precision();
+		if (precision == DataType::Single) {
+			m_ir.push_back(Instruction(Code::Precision, (uint64_t)DataType::Single));
+			lanes *= 2;
+		}
+		VirtualRegister grid = allocate(), out = allocate();
+		m_ir.push_back(Instruction(Code::IArgR, grid, 0));
+		m_ir.push_back(Instruction(Code::IArgR, out, 1));
+
+		// Level of each value: 0 invariant, 1 computed per row as it depends on y, 2 per point as it depends on x.
+		std::vector<unsigned> level(graph.size(), 0);
+		size_t arguments[2] { Value::None, Value::None }; // x, y
+		for (size_t v = 0; v < graph.size(); ++v) {
+			const Value& value = graph[v];
+			if (value.code == Code::IArgR || value.code == Code::FArgR) {
+				if (value.immediate > 1 || !isFloat(value.type)) throw std::invalid_argument("Grid kernels take the float arguments x and y only.");
+				arguments[value.immediate] = v;
+				level[v] = value.immediate == 0 ? 2 : 1;
+			}
+			for (size_t operand : value.operands) {
+				if (operand != Value::None) level[v] = std::max(level[v], level[operand]);
+			}
+		}
+
+		// Values read at a higher level are computed at their own, and copied by each of their consumers.
+		constexpr size_t Shared = SIZE_MAX / 2;
+		size_t root = graph.root();
+		std::vector<size_t> uses = m_uses, shared[2];
+		for (size_t v = 0; v < graph.size(); ++v) {
+			if (level[v] == 0 || uses[v] == 0) continue;
+			for (size_t operand : m_tiles[v].operands) {
+				if (operand == Value::None || operand == Tile::Same || level[operand] == level[v] || m_uses[operand] == Shared) continue;
+				m_uses[operand] = Shared;
+				shared[level[operand]].push_back(operand);
+			}
+		}
+		if (level[root] < 2) shared[level[root]].push_back(root);
+
+		bool integer = graph[root].type == DataType::Integer;
+		bool packed = lanes > 1 && !integer;
+		for (size_t v = 0; v < graph.size() && packed; ++v) {
+			if (level[v] > 0 && uses[v] > 0 && graph[v].code != Code::FArgR && !packable(m_tiles[v].code, m_options)) packed = false;
+		}
+		if (!packed) lanes = 1;
+
+		Layout result = resolve(layout, graph[root].type);
+
+		// Coordinates count from xmin and ymin by float indices, in every lane of packed loops.
+		bool used[2];
+		VirtualRegister origin[2], step[2], index[2];
+		for (size_t a = 0; a < 2; ++a) {
+			used[a] = arguments[a] != Value::None && uses[arguments[a]] > 0;
+			if (!used[a]) continue;
+			origin[a] = allocate();
+			step[a] = allocate();
+			m_ir.push_back(Instruction(Code::FParamR, origin[a], grid, offsetof(Grid, xmin) / 8 + 2 * a));
+			m_ir.push_back(Instruction(Code::FParamR, step[a], grid, offsetof(Grid, xstep) / 8 + 2 * a));
+		}
+		auto coordinate = [&](size_t a, uint64_t offset) {
+			VirtualRegister r = allocate();
+			m_ir.push_back(Instruction(Code::FMov, r, index[a]));
+			if (offset > 0) m_ir.push_back(Instruction(Code::FAddK, r, std::bit_cast<uint64_t>((double)offset)));
+			m_ir.push_back(Instruction(Code::FMul, r, step[a]));
+			m_ir.push_back(Instruction(Code::FAdd, r, origin[a]));
+			if (graph[arguments[a]].type != precision) m_ir.push_back(Instruction(Code::FToS, r));
+			m_values[arguments[a]] = r;
+		};
+		if (used[1]) {
+			index[1] = allocate();
+			m_ir.push_back(Instruction(Code::FParamR, index[1], grid, offsetof(Grid, row) / 8));
+		}
+
+		for (size_t v : shared[0]) gen(graph, v);
+		// Values the row loop reads from every lane. The target may clear the upper lanes before scalar loops,
+		// so they are broadcast again from the first one after the scalar loop of each row.
+		auto broadcast = [&] {
+			for (size_t a = 0; a < 2; ++a) {
+				if (!used[a]) continue;
+				m_ir.push_back(Instruction(Code::FBroadcast, origin[a], elementSize(precision)));
+				m_ir.push_back(Instruction(Code::FBroadcast, step[a], elementSize(precision)));
+			}
+			if (used[1]) m_ir.push_back(Instruction(Code::FBroadcast, index[1], elementSize(precision)));
+			for (size_t v : shared[0]) {
+				if (isFloat(graph[v].type)) m_ir.push_back(Instruction(Code::FBroadcast, m_values[v], elementSize(graph[v].type)));
+			}
+		};
+		if (packed) broadcast();
+
+		VirtualRegister rows = allocate(), count = allocate();
+		m_ir.push_back(Instruction(Code::ILoadM, rows, grid, offsetof(Grid, ny)));
+		m_ir.push_back(Instruction(Code::Loop, lanes));
+		m_ir.push_back(Instruction(Code::LoopTest, rows, 1));
+		if (used[1]) coordinate(1, 0);
+		for (size_t v : shared[1]) gen(graph, v);
+		m_ir.push_back(Instruction(Code::ILoadM, count, grid, offsetof(Grid, nx)));
+		if (used[0]) {
+			index[0] = allocate();
+			m_ir.push_back(Instruction(Code::FIota, index[0]));
+		}
+
+		unroll = std::max(unroll, size_t(1));
+		std::vector<size_t> steps { unroll * lanes };
+		if (lanes > 1 && unroll > 1) steps.push_back(lanes);
+		if (steps.back() > 1) steps.push_back(1);
+		for (size_t n : steps) {
+			size_t width = n % lanes == 0 ? lanes : 1;
+			m_ir.push_back(Instruction(Code::Loop, width));
+			m_ir.push_back(Instruction(Code::LoopTest, count, n));
+			for (m_element = 0; m_element < n; m_element += width) {
+				for (size_t v = 0; v < graph.size(); ++v) {
+					if (level[v] < 2) continue;
+					m_values[v] = Pending;
+					m_uses[v] = uses[v];
+				}
+				if (used[0]) coordinate(0, m_element);
+				uint64_t offset = result.offset + m_element * result.stride;
+				if (integer) m_ir.push_back(Instruction(Code::IStoreM, gen(graph, root), out, offset));
+				else m_ir.push_back(Instruction(Code::FStoreM, gen(graph, root), out, offset | elementSize(graph[root].type) << 32 | (uint64_t)result.stride << 40));
+			}
+			if (used[0]) m_ir.push_back(Instruction(Code::FAddK, index[0], std::bit_cast<uint64_t>((double)n)));
+			m_ir.push_back(Instruction(Code::IAddI, out, n * result.stride));
+			m_ir.push_back(Instruction(Code::ISubI, count, n));
+			m_ir.push_back(Code::LoopEnd);
+		}
+		if (packed && steps.back() == 1) broadcast();
+		if (used[1]) m_ir.push_back(Instruction(Code::FAddK, index[1], std::bit_cast<uint64_t>(1.0)));
+		m_ir.push_back(Instruction(Code::ISubI, rows, 1));
+		m_ir.push_back(Code::LoopEnd);
+		m_element = 0;
+		m_ir.push_back(Code::Ret);
+	}
+
+	void Generator::grid(const Layout& layout, size_t unroll, size_t lanes) {
+		grid(ValueGraph(m_expression, m_exprRoot, m_resultType), layout, unroll, lanes);
+	}
+
+	void Generator::operator()() {
+		( *this )( ValueGraph(m_expression, m_exprRoot, m_resultType) );
+	}
+}
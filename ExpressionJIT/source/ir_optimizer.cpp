@@ -1,30 +1,116 @@
-#include "include/exprjit/ir_optimizer.h"
-
-namespace exprjit::ir
-{
-	void Optimizer::operator()() {
-		for (size_t o = 0; o < optimizations.size(); ++o) {
-			size_t i = 0;
-			while (i < m_ir.size()) {
-				i = optimizations[o](m_ir, i);
-			}
-		}
-	}
-
-	std::vector<size_t(*)( std::vector<Instruction>& ir, size_t start)> Optimizer::optimizations {
-		[](std::vector<Instruction>& ir, size_t i) -> size_t {
-			size_t ni = i + 1;
-			if (ni >= ir.size()) return ni;
-			if(ir[i].operands[0].reg == ir[ni].operands[0].reg) { 
-				if (
-					ir[i].code == Code::IPush && ir[ni].code == Code::IPop || 
-					ir[i].code == Code::FPush && ir[ni].code == Code::FPop
-				) {
-					ir.erase(ir.begin() + i, ir.begin() + i + 2);
-					return i;
-				}
-			}
-			return ni;
-		}
-	};
-}
\ No newline at end of file
+#include "include/exprjit/ir_optimizer.h"
+#include <cstdint>
+
+namespace exprjit::ir
+{
+	// Fixed registers count as used many times, rules never drop their definitions.
+	size_t Optimizer::uses(VirtualRegister vr) const noexcept {
+		return isVirtual(vr) && vregIndex(vr) < m_uses.size() ? m_uses[vregIndex(vr)] : SIZE_MAX;
+	}
+
+	void Optimizer::use(VirtualRegister vr, int delta) noexcept {
+		if (isVirtual(vr) && vregIndex(vr) < m_uses.size()) m_uses[vregIndex(vr)] += delta;
+	}
+
+	void Optimizer::operator()() {
+		m_uses.clear();
+		for (const Instruction& i : m_ir) {
+			auto info = operandInfo(i.code);
+			for (size_t o = 0; o < 2; ++o) {
+				if (info[o].access != Access::Use && info[o].access != Access::UseDef) continue;
+				if (i.operands[o].immediate || !isVirtual(i.operands[o].reg)) continue;
+				size_t n = vregIndex(i.operands[o].reg);
+				if (n >= m_uses.size()) m_uses.resize(n + 1);
+				++m_uses[n];
+			}
+		}
+
+		std::vector<Instruction> out;
+		out.reserve(m_ir.size());
+		for (const Instruction& i : m_ir) {
+			out.push_back(i);
+			for (size_t r = 0; r < rules.size();) {
+				if (rules[r].length <= out.size() && rules[r].apply(*this, out)) r = 0;
+				else ++r;
+			}
+		}
+		m_ir.swap(out);
+	}
+
+	const std::vector<Optimizer::Rule> Optimizer::rules {
+		// XPush a; XPop b -> XMov b, a
+		{ 2, [](Optimizer&, std::vector<Instruction>& out) {
+			const Instruction& push = out[out.size() - 2], & pop = out.back();
+			Code mov;
+			if (push.code == Code::IPush && pop.code == Code::IPop) mov = Code::IMov;
+			else if (push.code == Code::FPush && pop.code == Code::FPop) mov = Code::FMov;
+			else return false;
+
+			Instruction rewritten(mov, pop.operands[0], push.operands[0]);
+			out.pop_back();
+			out.back() = rewritten;
+			return true;
+		} },
+		// XMov a, a ->
+		{ 1, [](Optimizer& o, std::vector<Instruction>& out) {
+			const Instruction& mov = out.back();
+			if (( mov.code != Code::IMov && mov.code != Code::FMov ) || mov.operands[0].reg != mov.operands[1].reg) return false;
+
+			o.use(mov.operands[1].reg, -1);
+			out.pop_back();
+			return true;
+		} },
+		// op t, ...; XMov d, t -> op d, ... when t is not read elsewhere and op only writes it
+		{ 2, [](Optimizer& o, std::vector<Instruction>& out) {
+			Instruction& def = out[out.size() - 2];
+			const Instruction& mov = out.back();
+			if (mov.code != Code::IMov && mov.code != Code::FMov) return false;
+			if (operandInfo(def.code)[0].access != Access::Def || def.operands[0].reg != mov.operands[1].reg) return false;
+			if (o.uses(mov.operands[1].reg) != 1) return false;
+
+			o.use(mov.operands[1].reg, -1);
+			def.operands[0] = mov.operands[0];
+			out.pop_back();
+			return true;
+		} },
+		// FToI i, f; IToF g, i; FToI j, g -> FToI i, f; IMov j, i
+		// i is a rounded double, so converting it back and forth is exact.
+		{ 3, [](Optimizer& o, std::vector<Instruction>& out) {
+			const Instruction& round = out[out.size() - 3], & widen = out[out.size() - 2], & narrow = out.back();
+			if (round.code != Code::FToI || widen.code != Code::IToF || narrow.code != Code::FToI) return false;
+			if (widen.operands[1].reg != round.operands[0].reg || narrow.operands[1].reg != widen.operands[0].reg) return false;
+
+			VirtualRegister i = round.operands[0].reg, g = widen.operands[0].reg;
+			Instruction rewritten(Code::IMov, narrow.operands[0], i);
+			o.use(g, -1);
+			o.use(i, 1);
+			out.pop_back();
+			if (o.uses(g) == 0) {
+				o.use(i, -1);
+				out.pop_back();
+			}
+			out.push_back(rewritten);
+			return true;
+		} },
+		// ILoadR t, k; op a, t -> opI a, k for add, sub and mul by a 32-bit literal read only there
+		{ 2, [](Optimizer& o, std::vector<Instruction>& out) {
+			const Instruction& load = out[out.size() - 2], & op = out.back();
+			if (load.code != Code::ILoadR || op.operands[1].immediate || op.operands[1].reg != load.operands[0].reg) return false;
+			Code code;
+			switch (op.code) {
+				case Code::IAdd: code = Code::IAddI; break;
+				case Code::ISub: code = Code::ISubI; break;
+				case Code::IMul: code = Code::IMulI; break;
+				default: return false;
+			}
+			int64_t k = (int64_t)load.operands[1].value;
+			if (k < INT32_MIN || k > INT32_MAX || o.uses(load.operands[0].reg) != 1) return false;
+
+			Instruction rewritten(code, op.operands[0], (uint64_t)k);
+			o.use(load.operands[0].reg, -1);
+			out.pop_back();
+			out.back() = rewritten;
+			return true;
+		} }
+	};
+}
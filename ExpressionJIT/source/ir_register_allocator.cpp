@@ -0,0 +1,148 @@
+#include "include/exprjit/ir_register_allocator.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace exprjit::ir
+{
+	constexpr size_t Unused = std::numeric_limits<size_t>::max();
+
+	void RegisterAllocator::operator()() {
+		m_slots = 0;
+		m_poolMask = 0;
+		buildIntervals();
+		scan(DataType::Integer, m_integerRegisters);
+		scan(DataType::Float, m_floatRegisters);
+		rewrite();
+	}
+
+	void RegisterAllocator::buildIntervals() {
+		m_intervals.clear();
+		for (size_t i = 0; i < m_ir.size(); ++i) {
+			auto info = operandInfo(m_ir[i].code);
+			for (size_t o = 0; o < 2; ++o) {
+				const Operand& op = m_ir[i].operands[o];
+				if (info[o].access == Access::None || op.immediate || !isVirtual(op.reg)) continue;
+
+				size_t v = vregIndex(op.reg);
+				if (v >= m_intervals.size()) {
+					m_intervals.resize(v + 1, { Unused, 0, DataType::Integer, false, 0 });
+				}
+				Interval& interval = m_intervals[v];
+				if (interval.start == Unused) {
+					if (info[o].access != Access::Def) throw std::invalid_argument("Virtual register is used before it is defined.");
+					interval.start = i;
+					interval.type = info[o].type;
+				}
+				interval.end = i;
+			}
+		}
+
+		// Values live into a loop are read again by its later iterations, they stay until the loop ends.
+		std::vector<size_t> heads;
+		for (size_t i = 0; i < m_ir.size(); ++i) {
+			if (m_ir[i].code == Code::Loop) heads.push_back(i);
+			if (m_ir[i].code != Code::LoopEnd) continue;
+			if (heads.empty()) throw std::invalid_argument("LoopEnd without a loop.");
+			size_t head = heads.back();
+			heads.pop_back();
+			for (Interval& interval : m_intervals) {
+				if (interval.start != Unused && interval.start < head && interval.end > head) interval.end = std::max(interval.end, i);
+			}
+		}
+	}
+
+	void RegisterAllocator::scan(DataType type, size_t registers) {
+		std::vector<size_t> order;
+		for (size_t v = 0; v < m_intervals.size(); ++v) {
+			if (m_intervals[v].start != Unused && m_intervals[v].type == type) order.push_back(v);
+		}
+		std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return m_intervals[a].start < m_intervals[b].start; });
+
+		std::vector<size_t> active; // sorted by end
+		std::vector<bool> busy(registers, false);
+		auto activate = [&](size_t v) {
+			auto at = std::upper_bound(active.begin(), active.end(), v, [this](size_t a, size_t b) { return m_intervals[a].end < m_intervals[b].end; });
+			active.insert(at, v);
+		};
+
+		for (size_t v : order) {
+			Interval& current = m_intervals[v];
+			while (!active.empty() && m_intervals[active.front()].end < current.start) {
+				busy[m_intervals[active.front()].location] = false;
+				active.erase(active.begin());
+			}
+
+			if (active.size() < registers) {
+				current.location = std::find(busy.begin(), busy.end(), false) - busy.begin();
+				busy[current.location] = true;
+				activate(v);
+				continue;
+			}
+
+			// Out of registers: the value needed furthest in the future goes to the stack.
+			Interval* victim = registers > 0 ? &m_intervals[active.back()] : nullptr;
+			if (victim && victim->end > current.end) {
+				current.location = victim->location;
+				victim->spilled = true;
+				victim->location = m_slots++;
+				active.pop_back();
+				activate(v);
+			}
+			else {
+				current.spilled = true;
+				current.location = m_slots++;
+			}
+		}
+
+		for (size_t v : order) {
+			if (!m_intervals[v].spilled) m_poolMask |= 1ull << ( m_intervals[v].location + ( type == DataType::Integer ? 0 : 32 ) );
+		}
+	}
+
+	void RegisterAllocator::rewrite() {
+		std::vector<Instruction> result;
+		result.reserve(m_ir.size() + 1);
+		// Slots hold whole registers of the widest packed loop.
+		uint64_t lanes = 1;
+		for (const Instruction& instruction : m_ir) {
+			if (instruction.code == Code::Loop) lanes = std::max(lanes, instruction.operands[0].value);
+		}
+		result.push_back(Instruction(Code::Enter, m_poolMask, m_slots, lanes));
+
+		for (const Instruction& instruction : m_ir) {
+			Instruction rewritten = instruction;
+			auto info = operandInfo(instruction.code);
+			size_t spills = 0;
+			Instruction after[2] { Code::None, Code::None };
+
+			for (size_t o = 0; o < 2; ++o) {
+				const Operand& op = instruction.operands[o];
+				if (info[o].access == Access::None || op.immediate || !isVirtual(op.reg)) continue;
+
+				const Interval& interval = m_intervals[vregIndex(op.reg)];
+				if (!interval.spilled) {
+					rewritten.operands[o] = poolRegister(interval.type, interval.location);
+					continue;
+				}
+
+				bool integer = interval.type == DataType::Integer;
+				VirtualRegister scratch = integer
+					? ( o == 0 ? VirtualRegister::I0 : VirtualRegister::I1 )
+					: ( o == 0 ? VirtualRegister::F0 : VirtualRegister::F1 );
+				rewritten.operands[o] = scratch;
+				if (info[o].access != Access::Def) {
+					result.push_back(Instruction(integer ? Code::IFill : Code::FFill, scratch, interval.location));
+				}
+				if (info[o].access != Access::Use) {
+					after[spills++] = Instruction(integer ? Code::ISpill : Code::FSpill, scratch, interval.location);
+				}
+			}
+
+			result.push_back(rewritten);
+			for (size_t s = 0; s < spills; ++s) result.push_back(after[s]);
+		}
+
+		m_ir = std::move(result);
+	}
+}
\ No newline at end of file
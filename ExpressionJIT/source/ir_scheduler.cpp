@@ -0,0 +1,169 @@
+#include "include/exprjit/ir_scheduler.h"
+#include <algorithm>
+#include <unordered_map>
+#include <set>
+#include <limits>
+
+namespace exprjit::ir
+{
+	constexpr size_t None = std::numeric_limits<size_t>::max();
+	constexpr size_t Window = 32; // candidates looked at per step, best first
+
+	static bool barrier(Code code) noexcept {
+		switch (code) {
+			case Code::Ret: case Code::Enter: case Code::Loop: case Code::LoopTest: case Code::LoopEnd: case Code::Precision:
+			case Code::ILoad: case Code::IArg: case Code::IPush: case Code::IPop: case Code::ISpill: case Code::IFill:
+			case Code::FLoad: case Code::FArg: case Code::FPush: case Code::FPop: case Code::FSpill: case Code::FFill:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void Scheduler::edge(size_t from, size_t to, unsigned latency) {
+		m_nodes[from].successors.push_back({ to, latency });
+		++m_nodes[to].predecessors;
+	}
+
+	// Read after write waits for the result, write after read and write after write only keep the order.
+	void Scheduler::buildGraph() {
+		m_nodes.assign(m_ir.size(), { {}, 0, 0, 0, 0 });
+		std::unordered_map<uint32_t, size_t> writer;
+		std::unordered_map<uint32_t, std::vector<size_t>> readers;
+		size_t lastBarrier = None;
+		std::vector<size_t> sinceBarrier;
+
+		for (size_t i = 0; i < m_ir.size(); ++i) {
+			const Instruction& instruction = m_ir[i];
+			m_nodes[i].latency = m_target.latency(instruction.code);
+			if (barrier(instruction.code)) {
+				for (size_t j : sinceBarrier) edge(j, i, 0);
+				sinceBarrier.clear();
+				if (lastBarrier != None) edge(lastBarrier, i, 0);
+				lastBarrier = i;
+			}
+			else {
+				if (lastBarrier != None) edge(lastBarrier, i, 0);
+				sinceBarrier.push_back(i);
+			}
+
+			auto info = operandInfo(instruction.code);
+			for (size_t o = 0; o < 2; ++o) {
+				if (info[o].access == Access::None || info[o].access == Access::Def || instruction.operands[o].immediate) continue;
+				uint32_t r = (uint32_t)instruction.operands[o].reg;
+				if (auto w = writer.find(r); w != writer.end()) edge(w->second, i, m_nodes[w->second].latency);
+				readers[r].push_back(i);
+			}
+			for (size_t o = 0; o < 2; ++o) {
+				if (info[o].access == Access::None || info[o].access == Access::Use || instruction.operands[o].immediate) continue;
+				uint32_t r = (uint32_t)instruction.operands[o].reg;
+				for (size_t reader : readers[r]) {
+					if (reader != i) edge(reader, i, 0);
+				}
+				readers[r].clear();
+				if (auto w = writer.find(r); w != writer.end() && info[o].access == Access::Def) edge(w->second, i, 1);
+				writer[r] = i;
+			}
+		}
+	}
+
+	void Scheduler::operator()() {
+		buildGraph();
+		for (size_t i = m_nodes.size(); i-- > 0;) {
+			Node& node = m_nodes[i];
+			node.height = node.latency;
+			for (const Edge& e : node.successors) node.height = std::max(node.height, e.latency + m_nodes[e.to].height);
+		}
+
+		// Live virtual registers: defined, and referred to by instructions not scheduled yet.
+		std::vector<size_t> references;
+		std::vector<bool> live;
+		for (const Instruction& instruction : m_ir) {
+			auto info = operandInfo(instruction.code);
+			for (size_t o = 0; o < 2; ++o) {
+				const Operand& op = instruction.operands[o];
+				if (info[o].access == Access::None || op.immediate || !isVirtual(op.reg)) continue;
+				if (o == 1 && !instruction.operands[0].immediate && op.reg == instruction.operands[0].reg) continue;
+				size_t v = vregIndex(op.reg);
+				if (v >= references.size()) references.resize(v + 1, 0);
+				++references[v];
+			}
+		}
+		live.assign(references.size(), false);
+		size_t liveCount[2] { 0, 0 };
+		size_t limit[2] { m_target.poolSize(DataType::Integer), m_target.poolSize(DataType::Float) };
+
+		// Change of the live registers of each type if i were scheduled now.
+		auto pressure = [&](size_t i, long delta[2]) {
+			const Instruction& instruction = m_ir[i];
+			auto info = operandInfo(instruction.code);
+			delta[0] = delta[1] = 0;
+			for (size_t o = 0; o < 2; ++o) {
+				const Operand& op = instruction.operands[o];
+				if (info[o].access == Access::None || op.immediate || !isVirtual(op.reg)) continue;
+				if (o == 1 && !instruction.operands[0].immediate && op.reg == instruction.operands[0].reg) continue;
+				size_t v = vregIndex(op.reg), type = info[o].type == DataType::Integer ? 0 : 1;
+				if (!live[v] && references[v] > 1) ++delta[type];
+				else if (live[v] && references[v] == 1) --delta[type];
+			}
+		};
+
+		// Candidates have all predecessors scheduled, the longest path first.
+		auto order = [this](size_t a, size_t b) {
+			return m_nodes[a].height != m_nodes[b].height ? m_nodes[a].height > m_nodes[b].height : a < b;
+		};
+		std::set<size_t, decltype(order)> candidates(order);
+		for (size_t i = 0; i < m_nodes.size(); ++i) {
+			if (m_nodes[i].predecessors == 0) candidates.insert(i);
+		}
+
+		std::vector<Instruction> result;
+		result.reserve(m_ir.size());
+		unsigned cycle = 0;
+		while (!candidates.empty()) {
+			// Prefer instructions that keep the pools from overflowing, then those whose operands are ready.
+			auto best = candidates.end();
+			int bestScore = -1;
+			size_t looked = 0;
+			for (auto it = candidates.begin(); it != candidates.end() && looked < Window; ++it, ++looked) {
+				long delta[2];
+				pressure(*it, delta);
+				bool fits = ( delta[0] <= 0 || liveCount[0] + delta[0] <= limit[0] ) && ( delta[1] <= 0 || liveCount[1] + delta[1] <= limit[1] );
+				int score = ( fits ? 2 : 0 ) + ( m_nodes[*it].ready <= cycle ? 1 : 0 );
+				if (score > bestScore) {
+					best = it;
+					bestScore = score;
+					if (score == 3) break;
+				}
+			}
+
+			size_t i = *best;
+			candidates.erase(best);
+			Node& node = m_nodes[i];
+			cycle = std::max(cycle, node.ready);
+
+			const Instruction& instruction = m_ir[i];
+			auto info = operandInfo(instruction.code);
+			for (size_t o = 0; o < 2; ++o) {
+				const Operand& op = instruction.operands[o];
+				if (info[o].access == Access::None || op.immediate || !isVirtual(op.reg)) continue;
+				if (o == 1 && !instruction.operands[0].immediate && op.reg == instruction.operands[0].reg) continue;
+				size_t v = vregIndex(op.reg), type = info[o].type == DataType::Integer ? 0 : 1;
+				bool wasLive = live[v];
+				live[v] = --references[v] > 0;
+				if (live[v] && !wasLive) ++liveCount[type];
+				else if (!live[v] && wasLive) --liveCount[type];
+			}
+
+			for (const Edge& e : node.successors) {
+				Node& successor = m_nodes[e.to];
+				successor.ready = std::max(successor.ready, cycle + e.latency);
+				if (--successor.predecessors == 0) candidates.insert(e.to);
+			}
+			result.push_back(instruction);
+			++cycle;
+		}
+
+		m_ir = std::move(result);
+	}
+}
\ No newline at end of file
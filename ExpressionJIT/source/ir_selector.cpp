@@ -0,0 +1,328 @@
+#include "include/exprjit/ir_selector.h"
+#include <climits>
+#include <cmath>
+#include <bit>
+
+namespace exprjit::ir
+{
+	// Rough latency of each instruction of the graph on its own, in cycles.
+	static unsigned latency(Code code) noexcept {
+		switch (code) {
+			case Code::IArgR: case Code::FArgR: case Code::IBlockR:
+				return 0;
+			case Code::IMul: case Code::IAbs:
+				return 3;
+			case Code::IDiv: case Code::IMod:
+				return 40;
+			case Code::FLoadR: case Code::FParamR: case Code::FAdd: case Code::FSub: case Code::FMul: case Code::IToF: case Code::FToI:
+			case Code::SToF: case Code::FToS:
+				return 4;
+			case Code::FDiv:
+				return 14;
+			case Code::FFloor:
+				return 8;
+			case Code::FSin: case Code::FCos: case Code::FTan: case Code::FMod:
+				return 40;
+			default:
+				return 1;
+		}
+	}
+
+	static bool literal(const ValueGraph& graph, size_t v, DataType type) noexcept {
+		return graph[v].code == ( type == DataType::Integer ? Code::ILoadR : Code::FLoadR );
+	}
+
+	static bool int32(const ValueGraph& graph, size_t v) noexcept {
+		int64_t value = (int64_t)graph[v].immediate;
+		return literal(graph, v, DataType::Integer) && value >= INT32_MIN && value <= INT32_MAX;
+	}
+
+	// Node that may be covered by a tile of its only user.
+	static bool inner(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Code code) noexcept {
+		return graph[v].code == code && uses[v] == 1;
+	}
+
+	// Operand of commutative value v that satisfies test, the other one in other.
+	template<typename Test>
+	static bool either(const ValueGraph& graph, size_t v, size_t& match, size_t& other, Test test) {
+		for (size_t o = 0; o < 2; ++o) {
+			if (test(graph[v].operands[o])) {
+				match = graph[v].operands[o];
+				other = graph[v].operands[1 - o];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static uint64_t lea(int64_t scale, int64_t disp) noexcept {
+		return (uint64_t)scale | (uint64_t)(uint32_t)(int32_t)disp << 32;
+	}
+
+	// Index * scale for the scales an address can take.
+	static bool scaled(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, size_t& index, int64_t& scale) {
+		if (!inner(graph, uses, v, Code::IMul)) return false;
+		size_t factor;
+		return either(graph, v, factor, index, [&](size_t o) {
+			int64_t s = (int64_t)graph[o].immediate;
+			return literal(graph, o, DataType::Integer) && ( s == 2 || s == 4 || s == 8 );
+		}) && ( scale = (int64_t)graph[factor].immediate, true );
+	}
+
+	// The value's own instruction.
+	static bool instruction(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		tile.code = value.code;
+		tile.operands[0] = value.operands[0];
+		tile.operands[1] = value.operands[1];
+		tile.immediate = value.code == Code::ILoadR || value.code == Code::FLoadR || value.code == Code::IArgR || value.code == Code::FArgR
+			|| value.code == Code::FParamR ? value.immediate : 0;
+		tile.cost += latency(value.code);
+		return true;
+	}
+
+	// x + c, x - c: imm32 forms.
+	static bool addImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		size_t c, x;
+		if (value.code == Code::IAdd && either(graph, v, c, x, [&](size_t o) { return int32(graph, o); })) {
+			tile.code = Code::IAddI;
+		}
+		else if (value.code == Code::ISub && int32(graph, value.operands[1])) {
+			c = value.operands[1];
+			x = value.operands[0];
+			tile.code = Code::ISubI;
+		}
+		else return false;
+		tile.operands[0] = x;
+		tile.immediate = graph[c].immediate;
+		return true;
+	}
+
+	// x * c: imul r, r, imm32.
+	static bool multiplyImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		size_t c, x;
+		if (graph[v].code != Code::IMul || !either(graph, v, c, x, [&](size_t o) { return int32(graph, o); })) return false;
+		tile.code = Code::IMulI;
+		tile.operands[0] = x;
+		tile.immediate = graph[c].immediate;
+		return true;
+	}
+
+	// x / c, x % c: the target picks a sequence for the divisor.
+	static bool divideImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		if (( value.code != Code::IDiv && value.code != Code::IMod ) || !literal(graph, value.operands[1], DataType::Integer)) return false;
+		tile.code = value.code == Code::IDiv ? Code::IDivI : Code::IModI;
+		tile.operands[0] = value.operands[0];
+		tile.immediate = graph[value.operands[1]].immediate;
+		return true;
+	}
+
+	// a + b * s: lea a, [a + b * s].
+	static bool scaledAdd(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile) {
+		if (graph[v].code != Code::IAdd) return false;
+		size_t product, base, index;
+		int64_t scale;
+		if (!either(graph, v, product, base, [&](size_t o) { return scaled(graph, uses, o, index, scale); })) return false;
+		tile.code = Code::ILea;
+		tile.operands[0] = base;
+		tile.operands[1] = index;
+		tile.immediate = lea(scale, 0);
+		return true;
+	}
+
+	// x * 3, x * 5, x * 9: lea x, [x + x * (c - 1)].
+	static bool multiplyLea(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		if (graph[v].code != Code::IMul) return false;
+		size_t c, x;
+		if (!either(graph, v, c, x, [&](size_t o) {
+			int64_t s = (int64_t)graph[o].immediate;
+			return literal(graph, o, DataType::Integer) && ( s == 3 || s == 5 || s == 9 );
+		})) return false;
+		tile.code = Code::ILea;
+		tile.operands[0] = x;
+		tile.operands[1] = Tile::Same;
+		tile.immediate = lea((int64_t)graph[c].immediate - 1, 0);
+		return true;
+	}
+
+	// a + b + c, a + b * s + c (and - c): lea a, [a + b * s + c].
+	static bool displacedAdd(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		size_t c, sum;
+		if (value.code == Code::IAdd) {
+			if (!either(graph, v, c, sum, [&](size_t o) { return int32(graph, o); })) return false;
+		}
+		else if (value.code == Code::ISub && int32(graph, value.operands[1]) && (int64_t)graph[value.operands[1]].immediate != INT32_MIN) {
+			c = value.operands[1];
+			sum = value.operands[0];
+		}
+		else return false;
+		if (!inner(graph, uses, sum, Code::IAdd)) return false;
+
+		int64_t disp = (int64_t)graph[c].immediate, scale = 1;
+		size_t product, base, index;
+		if (!either(graph, sum, product, base, [&](size_t o) { return scaled(graph, uses, o, index, scale); })) {
+			base = graph[sum].operands[0];
+			index = graph[sum].operands[1];
+		}
+		tile.code = Code::ILea;
+		tile.operands[0] = base;
+		tile.operands[1] = index;
+		tile.immediate = lea(scale, value.code == Code::ISub ? -disp : disp);
+		return true;
+	}
+
+	// x + c, x - c: memory operand form, the literal is not loaded to a register. x - c is exactly x + -c.
+	static bool floatAddImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		size_t c, x;
+		if (value.code == Code::FAdd && either(graph, v, c, x, [&](size_t o) { return literal(graph, o, DataType::Float); })) {
+			tile.immediate = graph[c].immediate;
+		}
+		else if (value.code == Code::FSub && literal(graph, value.operands[1], DataType::Float)) {
+			x = value.operands[0];
+			tile.immediate = graph[value.operands[1]].immediate ^ 0x8000000000000000;
+		}
+		else return false;
+		tile.code = Code::FAddK;
+		tile.operands[0] = x;
+		return true;
+	}
+
+	// x * c: memory operand form.
+	static bool floatMultiplyImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		size_t c, x;
+		if (graph[v].code != Code::FMul || !either(graph, v, c, x, [&](size_t o) { return literal(graph, o, DataType::Float); })) return false;
+		tile.code = Code::FMulK;
+		tile.operands[0] = x;
+		tile.immediate = graph[c].immediate;
+		return true;
+	}
+
+	// x / c: memory operand form.
+	static bool floatDivideImmediate(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		if (value.code != Code::FDiv || !literal(graph, value.operands[1], DataType::Float)) return false;
+		tile.code = Code::FDivK;
+		tile.operands[0] = value.operands[0];
+		tile.immediate = graph[value.operands[1]].immediate;
+		return true;
+	}
+
+	// x / 2^k: x * 2^-k, exact while 2^-k is normal in the value's precision.
+	static bool divideByPowerOfTwo(const ValueGraph& graph, const std::vector<size_t>&, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		if (value.code != Code::FDiv || !literal(graph, value.operands[1], DataType::Float)) return false;
+		int exponent;
+		double divisor = std::bit_cast<double>(graph[value.operands[1]].immediate);
+		int limit = value.type == DataType::Single ? 127 : 1023;
+		if (!std::isnormal(divisor) || std::abs(std::frexp(divisor, &exponent)) != 0.5 || exponent < 2 - limit || exponent > limit) return false;
+		tile.code = Code::FMulK;
+		tile.operands[0] = value.operands[0];
+		tile.immediate = std::bit_cast<uint64_t>(1.0 / divisor);
+		return true;
+	}
+
+	// -floor(-x): ceil x, one rounding instruction.
+	static bool ceiling(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile) {
+		if (graph[v].code != Code::FNeg) return false;
+		size_t floor = graph[v].operands[0];
+		if (!inner(graph, uses, floor, Code::FFloor)) return false;
+		size_t negation = graph[floor].operands[0];
+		if (!inner(graph, uses, negation, Code::FNeg)) return false;
+		tile.code = Code::FCeil;
+		tile.operands[0] = graph[negation].operands[0];
+		return true;
+	}
+
+	// a * b + c, a * b - c (fast math): dst = a, fma a, b, [c].
+	static bool multiplyAddImmediate(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		size_t c, product;
+		if (value.code == Code::FAdd) {
+			if (!either(graph, v, c, product, [&](size_t o) { return literal(graph, o, DataType::Float); })) return false;
+			tile.immediate = graph[c].immediate;
+		}
+		else if (value.code == Code::FSub && literal(graph, value.operands[1], DataType::Float)) {
+			product = value.operands[0];
+			tile.immediate = graph[value.operands[1]].immediate ^ 0x8000000000000000;
+		}
+		else return false;
+		if (!inner(graph, uses, product, Code::FMul)) return false;
+		tile.code = Code::FMulAddK;
+		tile.operands[0] = graph[product].operands[0];
+		tile.operands[1] = graph[product].operands[1];
+		return true;
+	}
+
+	// c + a * k, c - a * k (fast math): dst = c, fma c, a, [k].
+	static bool addMultipliedImmediate(const ValueGraph& graph, const std::vector<size_t>& uses, size_t v, Tile& tile) {
+		const Value& value = graph[v];
+		size_t product, sum;
+		if (value.code == Code::FAdd) {
+			if (!either(graph, v, product, sum, [&](size_t o) { return inner(graph, uses, o, Code::FMul); })) return false;
+		}
+		else if (value.code == Code::FSub && inner(graph, uses, value.operands[1], Code::FMul)) {
+			product = value.operands[1];
+			sum = value.operands[0];
+		}
+		else return false;
+		size_t k, a;
+		if (!either(graph, product, k, a, [&](size_t o) { return literal(graph, o, DataType::Float); })) return false;
+		tile.code = Code::FMulKAdd;
+		tile.operands[0] = sum;
+		tile.operands[1] = a;
+		tile.immediate = graph[k].immediate ^ ( value.code == Code::FSub ? 0x8000000000000000 : 0 );
+		return true;
+	}
+
+	// Costs are rough latencies in cycles, see latency.
+	const std::vector<Pattern> Selector::patterns {
+		{ "instruction",			0,	false,	instruction				},
+		{ "add imm",				1,	false,	addImmediate			},
+		{ "mul imm",				3,	false,	multiplyImmediate		},
+		{ "div imm",				8,	false,	divideImmediate			},
+		{ "lea scaled add",			1,	false,	scaledAdd				},
+		{ "lea multiply",			1,	false,	multiplyLea				},
+		{ "lea displaced add",		1,	false,	displacedAdd			},
+		{ "float add mem",			5,	false,	floatAddImmediate		},
+		{ "float mul mem",			5,	false,	floatMultiplyImmediate	},
+		{ "float div mem",			15,	false,	floatDivideImmediate	},
+		{ "div power of two",		5,	false,	divideByPowerOfTwo		},
+		{ "ceil",					8,	false,	ceiling					},
+		{ "fma imm",				5,	true,	multiplyAddImmediate	},
+		{ "fma imm factor",			5,	true,	addMultipliedImmediate	},
+	};
+
+	Selector::Selector(const ValueGraph& graph, const CompileOptions& options) : m_tiles(graph.size()) {
+		std::vector<size_t> uses = graph.useCounts();
+		for (size_t v = 0; v < graph.size(); ++v) {
+			Tile& best = m_tiles[v];
+			best.cost = UINT_MAX;
+			for (const Pattern& pattern : patterns) {
+				if (pattern.fastMath && !options.fastMath) continue;
+				Tile tile { Code::None, { Value::None, Value::None }, 0, pattern.cost };
+				if (!pattern.match(graph, uses, v, tile)) continue;
+				// Shared operands are paid for once, by whichever tile they get.
+				for (size_t o : tile.operands) {
+					if (o < graph.size() && uses[o] == 1) tile.cost += m_tiles[o].cost;
+				}
+				if (tile.cost < best.cost) best = tile;
+			}
+		}
+	}
+
+	std::vector<size_t> Selector::useCounts(size_t root) const {
+		std::vector<size_t> uses(m_tiles.size(), 0);
+		++uses[root];
+		for (size_t v = m_tiles.size(); v-- > 0;) {
+			if (uses[v] == 0) continue;
+			for (size_t o : m_tiles[v].operands) {
+				if (o < m_tiles.size()) ++uses[o];
+			}
+		}
+		return uses;
+	}
+}
\ No newline at end of file
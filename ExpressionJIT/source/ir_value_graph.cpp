@@ -0,0 +1,145 @@
+#include "include/exprjit/ir_value_graph.h"
+#include <stdexcept>
+#include <utility>
+#include <bit>
+
+namespace exprjit::ir
+{
+	std::unordered_map<ExpressionNode::Binop, std::pair<Code, Code>> binopMap {
+		{ ExpressionNode::Binop::Add,		{ Code::IAdd, Code::FAdd } },
+		{ ExpressionNode::Binop::Subtract,	{ Code::ISub, Code::FSub } },
+		{ ExpressionNode::Binop::Multiply,	{ Code::IMul, Code::FMul } },
+		{ ExpressionNode::Binop::Divide,		{ Code::IDiv, Code::FDiv } },
+		{ ExpressionNode::Binop::Modulo,		{ Code::IMod, Code::FMod } }
+	};
+	std::unordered_map<ExpressionNode::Unop, std::pair<Code, Code>> unopMap {
+		{ ExpressionNode::Unop::Negate, { Code::INeg, Code::FNeg		} },
+		{ ExpressionNode::Unop::Abs,		{ Code::IAbs, Code::FAbs		} },
+		{ ExpressionNode::Unop::Sin,		{ Code::None, Code::FSin		} },
+		{ ExpressionNode::Unop::Cos,		{ Code::None, Code::FCos		} },
+		{ ExpressionNode::Unop::Floor,	{ Code::None, Code::FFloor	} },
+	};
+
+	static bool commutative(Code code) noexcept {
+		return code == Code::IAdd || code == Code::IMul || code == Code::FAdd || code == Code::FMul;
+	}
+
+	size_t ValueGraph::Hash::operator()(const Value& v) const noexcept {
+		uint64_t h = (uint64_t)v.code * 0x9E3779B97F4A7C15ull;
+		for (uint64_t part : { (uint64_t)v.type, (uint64_t)v.operands[0], (uint64_t)v.operands[1], v.immediate }) {
+			h = ( h ^ part ) * 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+		}
+		return (size_t)h;
+	}
+
+	ValueGraph::ValueGraph(const std::vector<ExpressionNode>& expr, size_t root, DataType resultType)
+		: m_precision(floatPrecision(expr, root, resultType)) {
+		m_root = convert(build(expr, root), resultType);
+		m_numbers.clear();
+	}
+
+	std::vector<size_t> ValueGraph::useCounts() const {
+		std::vector<size_t> uses(m_values.size(), 0);
+		for (const Value& v : m_values) {
+			for (size_t op : v.operands) {
+				if (op != Value::None) ++uses[op];
+			}
+		}
+		++uses[m_root];
+		return uses;
+	}
+
+	size_t ValueGraph::number(Code code, DataType type, size_t a, size_t b, uint64_t immediate) {
+		if (commutative(code) && b < a) std::swap(a, b);
+		Value value { code, type, { a, b }, immediate };
+		auto [it, inserted] = m_numbers.insert({ value, m_values.size() });
+		if (inserted) m_values.push_back(value);
+		return it->second;
+	}
+
+	size_t ValueGraph::convert(size_t v, DataType type) {
+		DataType from = m_values[v].type;
+		if (from == type) return v;
+		if (from == DataType::Integer) return number(Code::IToF, type, v);
+		if (type == DataType::Integer) return number(Code::FToI, type, v);
+		return number(type == DataType::Float ? Code::SToF : Code::FToS, type, v);
+	}
+
+	size_t ValueGraph::build(const std::vector<ExpressionNode>& expr, size_t i) {
+		auto& node = expr[i];
+
+		switch (node.type) {
+			case ExpressionNode::Type::Binop:
+			{
+				auto code = binopMap.at(node.binop.op);
+				size_t rhs = build(expr, node.binop.rhs);
+				size_t lhs = build(expr, node.binop.lhs);
+				DataType resT = promote(m_values[lhs].type, m_values[rhs].type);
+				lhs = convert(lhs, resT);
+				rhs = convert(rhs, resT);
+				return number(resT == DataType::Integer ? code.first : code.second, resT, lhs, rhs);
+			}
+			case ExpressionNode::Type::Unop:
+			{
+				size_t op = build(expr, node.unop.operand);
+				if (node.unop.op == ExpressionNode::Unop::FToI) {
+					return convert(op, DataType::Integer);
+				}
+				else if (node.unop.op == ExpressionNode::Unop::IToF) {
+					return isFloat(m_values[op].type) ? op : convert(op, m_precision);
+				}
+				const auto& code = unopMap.at(node.unop.op);
+
+				DataType iT;
+				Code iC;
+				if (m_values[op].type == DataType::Integer) {
+					if (code.first == Code::None) {
+						iT = m_precision;
+						iC = code.second;
+					}
+					else {
+						iT = DataType::Integer;
+						iC = code.first;
+					}
+				}
+				else {
+					if (code.second == Code::None) {
+						iT = DataType::Integer;
+						iC = code.first;
+					}
+					else {
+						iT = m_values[op].type;
+						iC = code.second;
+					}
+				}
+
+				return number(iC, iT, convert(op, iT));
+			}
+			case ExpressionNode::Type::Argument:
+			{
+				if (node.argument.type == DataType::Integer) {
+					return number(Code::IArgR, DataType::Integer, Value::None, Value::None, node.argument.index);
+				}
+				size_t argument = number(Code::FArgR, node.argument.type, Value::None, Value::None, node.argument.index);
+				return convert(argument, m_precision);
+			}
+			case ExpressionNode::Type::Literal:
+			{
+				if (node.literal.type == DataType::Integer) {
+					return number(Code::ILoadR, DataType::Integer, Value::None, Value::None, node.literal.value);
+				}
+				uint64_t value = node.literal.value;
+				if (m_precision == DataType::Single) value = std::bit_cast<uint64_t>((double)(float)std::bit_cast<double>(value));
+				return number(Code::FLoadR, m_precision, Value::None, Value::None, value);
+			}
+			case ExpressionNode::Type::Parameter:
+			{
+				size_t block = number(Code::IBlockR, DataType::Integer, Value::None);
+				return number(Code::FParamR, m_precision, block, Value::None, node.parameter.index);
+			}
+			default:
+				throw std::invalid_argument("Unknown expression node.");
+		}
+	}
+}
\ No newline at end of file
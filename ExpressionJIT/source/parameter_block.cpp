@@ -0,0 +1,49 @@
+#include "include/exprjit/parameter_block.h"
+#include <stdexcept>
+
+namespace exprjit
+{
+	ParameterBlock::ParameterBlock(size_t capacity) : m_values(new Value[capacity]), m_capacity(capacity) {
+		for (size_t i = 0; i < capacity; ++i) m_values[i].store(0.0, std::memory_order_relaxed);
+	}
+
+	unsigned ParameterBlock::index(std::string_view name) {
+		if (auto found = find(name)) return *found;
+		if (m_names.size() == m_capacity) throw std::length_error("Parameter block is full.");
+		m_names.emplace_back(name);
+		return (unsigned)( m_names.size() - 1 );
+	}
+
+	std::optional<unsigned> ParameterBlock::find(std::string_view name) const noexcept {
+		for (size_t i = 0; i < m_names.size(); ++i) {
+			if (m_names[i] == name) return (unsigned)i;
+		}
+		return std::nullopt;
+	}
+
+	bool readsParameters(const std::vector<ExpressionNode>& expr, size_t root) {
+		std::vector<size_t> stack { root };
+		std::vector<bool> seen(expr.size(), false); // subtrees may be shared
+		while (!stack.empty()) {
+			size_t i = stack.back();
+			stack.pop_back();
+			if (seen[i]) continue;
+			seen[i] = true;
+			const ExpressionNode& node = expr[i];
+			switch (node.type) {
+				case ExpressionNode::Type::Parameter:
+					return true;
+				case ExpressionNode::Type::Binop:
+					stack.push_back(node.binop.lhs);
+					stack.push_back(node.binop.rhs);
+					break;
+				case ExpressionNode::Type::Unop:
+					stack.push_back(node.unop.operand);
+					break;
+				default:
+					break;
+			}
+		}
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "include/exprjit/partial_evaluation.h"
+
+namespace exprjit
+{
+	void bindArguments(std::vector<ExpressionNode>& expr, const std::vector<ArgumentBinding>& bindings) {
+		for (ExpressionNode& node : expr) {
+			if (node.type != ExpressionNode::Type::Argument) continue;
+			unsigned bound = 0; // arguments before this one that are gone
+			const ArgumentBinding* binding = nullptr;
+			for (const ArgumentBinding& b : bindings) {
+				if (b.index == node.argument.index) binding = &b;
+				else if (b.index < node.argument.index) ++bound;
+			}
+			if (binding) node = ExpressionNode::makeLiteral(binding->value, node.argument.type, true);
+			else node.argument.index -= bound;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "include/exprjit/simplifier.h"
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+
+namespace exprjit
+{
+	constexpr size_t NewNode = std::numeric_limits<size_t>::max(); // simplified node replaces no node of the tree
+
+	static bool isLiteral(uint64_t value, DataType type, double f, int64_t i) noexcept {
+		return isFloat(type) ? value == std::bit_cast<uint64_t>(f) : value == (uint64_t)i;
+	}
+
+	size_t Simplifier::operator()() {
+		return simplify(m_root).node;
+	}
+
+	// Single values are folded as doubles and rounded here. Float literals are typed, so the arguments they replace
+	// still decide the precision of the simplified tree.
+	Simplifier::Result Simplifier::literal(uint64_t value, DataType type) {
+		if (type == DataType::Single) value = std::bit_cast<uint64_t>((double)(float)std::bit_cast<double>(value));
+		m_expr.push_back(ExpressionNode::makeLiteral(value, type, isFloat(type)));
+		return { m_expr.size() - 1, type, true, value };
+	}
+
+	Simplifier::Result Simplifier::node(ExpressionNode node, DataType type) {
+		m_expr.push_back(node);
+		return { m_expr.size() - 1, type, false, 0 };
+	}
+
+	Simplifier::Result Simplifier::convert(Result r, DataType type) {
+		if (r.type == type) return r;
+		if (isFloat(r.type) && isFloat(type)) {
+			// Single and Float differ in precision only, ir::ValueGraph converts the values it reads
+			if (r.constant) return literal(r.value, type);
+			return { r.node, type, false, 0 };
+		}
+		if (isFloat(type)) {
+			if (r.constant) return literal(std::bit_cast<uint64_t>((double)(int64_t)r.value), type);
+			return node(ExpressionNode::makeUnop(ExpressionNode::Unop::IToF, r.node), type);
+		}
+		if (r.constant) {
+			// cvtsd2si under the default rounding mode, out of range values are left to the target
+			double f = std::nearbyint(std::bit_cast<double>(r.value));
+			if (f >= -0x1p63 && f < 0x1p63) return literal((uint64_t)(int64_t)f, type);
+		}
+		return node(ExpressionNode::makeUnop(ExpressionNode::Unop::FToI, r.node), type);
+	}
+
+	Simplifier::Result Simplifier::simplify(size_t i) {
+		auto found = m_results.find(i);
+		if (found != m_results.end()) return found->second;
+
+		ExpressionNode n = m_expr[i];
+		Result result;
+		switch (n.type) {
+			case ExpressionNode::Type::Literal:
+				result = { i, n.literal.type, true, n.literal.value };
+				if (isFloat(result.type)) result = convert(result, m_precision);
+				break;
+			case ExpressionNode::Type::Argument:
+				result = { i, isFloat(n.argument.type) ? m_precision : n.argument.type, false, 0 };
+				break;
+			case ExpressionNode::Type::Parameter:
+				result = { i, m_precision, false, 0 };
+				break;
+			case ExpressionNode::Type::Binop:
+				if (m_options.fastMath && n.binop.op != ExpressionNode::Binop::Divide && n.binop.op != ExpressionNode::Binop::Modulo
+					&& isFloat(typeOf(i))) {
+					result = reassociate(i);
+					break;
+				}
+				result = simplifyBinop(i, n.binop.op, simplify(n.binop.lhs), simplify(n.binop.rhs));
+				break;
+			case ExpressionNode::Type::Unop:
+				result = simplifyUnop(i, n.unop.op, simplify(n.unop.operand));
+				break;
+		}
+		m_results.insert({ i, result });
+		return result;
+	}
+
+	Simplifier::Result Simplifier::simplifyBinop(size_t i, ExpressionNode::Binop op, Result lhs, Result rhs) {
+		using Binop = ExpressionNode::Binop;
+		DataType type = promote(lhs.type, rhs.type);
+		bool integer = type == DataType::Integer;
+		// Constant operands take the operation's type here instead of being converted at run time.
+		if (lhs.constant) lhs = convert(lhs, type);
+		if (rhs.constant) rhs = convert(rhs, type);
+
+		if (lhs.constant && rhs.constant) {
+			if (integer) {
+				int64_t a = (int64_t)lhs.value, b = (int64_t)rhs.value;
+				switch (op) {
+					case Binop::Add: return literal(lhs.value + rhs.value, type);
+					case Binop::Subtract: return literal(lhs.value - rhs.value, type);
+					case Binop::Multiply: return literal(lhs.value * rhs.value, type);
+					// division by zero and the INT64_MIN / -1 overflow trap at run time, they are left to do so
+					case Binop::Divide: if (b != 0 && !( a == INT64_MIN && b == -1 )) return literal((uint64_t)( a / b ), type); break;
+					case Binop::Modulo: if (b != 0 && !( a == INT64_MIN && b == -1 )) return literal((uint64_t)( a % b ), type); break;
+				}
+			}
+			else {
+				double a = std::bit_cast<double>(lhs.value), b = std::bit_cast<double>(rhs.value);
+				switch (op) {
+					case Binop::Add: return literal(std::bit_cast<uint64_t>(a + b), type);
+					case Binop::Subtract: return literal(std::bit_cast<uint64_t>(a - b), type);
+					case Binop::Multiply: return literal(std::bit_cast<uint64_t>(a * b), type);
+					case Binop::Divide: return literal(std::bit_cast<uint64_t>(a / b), type);
+					case Binop::Modulo: return literal(std::bit_cast<uint64_t>(std::fmod(a, b)), type);
+				}
+			}
+		}
+
+		auto is = [&](const Result& r, double f, int64_t v) { return r.constant && isLiteral(r.value, type, f, v); };
+		bool exact = integer || m_options.fastMath; // rules that hold for floats only without NaN, infinities and -0
+		switch (op) {
+			case Binop::Add:
+				if (is(rhs, -0.0, 0) || ( exact && is(rhs, 0.0, 0) )) return convert(lhs, type);
+				if (is(lhs, -0.0, 0) || ( exact && is(lhs, 0.0, 0) )) return convert(rhs, type);
+				break;
+			case Binop::Subtract:
+				if (is(rhs, 0.0, 0) || ( exact && is(rhs, -0.0, 0) )) return convert(lhs, type);
+				if (exact && is(lhs, 0.0, 0)) return simplifyUnop(NewNode, ExpressionNode::Unop::Negate, rhs);
+				break;
+			case Binop::Multiply:
+				if (is(rhs, 1.0, 1)) return convert(lhs, type);
+				if (is(lhs, 1.0, 1)) return convert(rhs, type);
+				if (exact && ( is(lhs, 0.0, 0) || is(rhs, 0.0, 0) )) return literal(integer ? 0 : std::bit_cast<uint64_t>(0.0), type);
+				break;
+			case Binop::Divide:
+				if (is(rhs, 1.0, 1)) return convert(lhs, type);
+				if (!integer && m_options.fastMath && rhs.constant) {
+					double reciprocal = 1.0 / std::bit_cast<double>(rhs.value);
+					if (std::isnormal(reciprocal)) {
+						return simplifyBinop(NewNode, Binop::Multiply, convert(lhs, type), literal(std::bit_cast<uint64_t>(reciprocal), type));
+					}
+				}
+				break;
+			default:
+				break;
+		}
+
+		if (i != NewNode && m_expr[i].binop.lhs == lhs.node && m_expr[i].binop.rhs == rhs.node) return { i, type, false, 0 };
+		return node(ExpressionNode::makeBinop(op, lhs.node, rhs.node), type);
+	}
+
+	// Type of a subtree as simplify would give it, without simplifying it.
+	DataType Simplifier::typeOf(size_t i) {
+		auto found = m_types.find(i);
+		if (found != m_types.end()) return found->second;
+
+		using Unop = ExpressionNode::Unop;
+		const ExpressionNode& n = m_expr[i];
+		DataType type = m_precision;
+		switch (n.type) {
+			case ExpressionNode::Type::Literal: if (!isFloat(n.literal.type)) type = n.literal.type; break;
+			case ExpressionNode::Type::Argument: if (!isFloat(n.argument.type)) type = n.argument.type; break;
+			case ExpressionNode::Type::Parameter: break;
+			case ExpressionNode::Type::Binop:
+				type = promote(typeOf(n.binop.lhs), typeOf(n.binop.rhs));
+				break;
+			case ExpressionNode::Type::Unop:
+				if (n.unop.op == Unop::FToI) type = DataType::Integer;
+				else if (n.unop.op == Unop::Negate || n.unop.op == Unop::Abs) type = typeOf(n.unop.operand);
+				break;
+		}
+		m_types.insert({ i, type });
+		return type;
+	}
+
+	Simplifier::Result Simplifier::balance(std::vector<Result> terms, ExpressionNode::Binop op) {
+		while (terms.size() > 1) {
+			std::vector<Result> next;
+			for (size_t t = 0; t + 1 < terms.size(); t += 2) next.push_back(simplifyBinop(NewNode, op, terms[t], terms[t + 1]));
+			if (terms.size() % 2 != 0) next.push_back(terms.back());
+			terms = std::move(next);
+		}
+		return terms[0];
+	}
+
+	// Fast math: a float chain of additions and subtractions, or of multiplications, becomes a balanced tree
+	// of the terms added, minus one of those subtracted, with the literals folded into one. Integer subtrees
+	// are terms as a whole, so integer arithmetic is left as written.
+	Simplifier::Result Simplifier::reassociate(size_t i) {
+		using Binop = ExpressionNode::Binop;
+		bool additive = m_expr[i].binop.op != Binop::Multiply;
+		auto chained = [&](size_t n) {
+			const ExpressionNode& node = m_expr[n];
+			if (node.type != ExpressionNode::Type::Binop || !isFloat(typeOf(n))) return false;
+			return additive ? node.binop.op == Binop::Add || node.binop.op == Binop::Subtract : node.binop.op == Binop::Multiply;
+		};
+
+		std::vector<Result> terms[2]; // added (multiplied), subtracted
+		double constant = additive ? 0.0 : 1.0;
+		std::vector<std::pair<size_t, bool>> pending { { i, false } };
+		while (!pending.empty()) {
+			auto [n, negative] = pending.back();
+			pending.pop_back();
+			if (chained(n)) {
+				const ExpressionNode& node = m_expr[n];
+				pending.push_back({ node.binop.rhs, negative != ( node.binop.op == Binop::Subtract ) });
+				pending.push_back({ node.binop.lhs, negative });
+				continue;
+			}
+			Result term = convert(simplify(n), m_precision);
+			if (!term.constant) terms[negative].push_back(term);
+			else if (!additive) constant *= std::bit_cast<double>(term.value);
+			else constant += negative ? -std::bit_cast<double>(term.value) : std::bit_cast<double>(term.value);
+		}
+
+		if (constant != ( additive ? 0.0 : 1.0 ) || ( terms[0].empty() && terms[1].empty() )) {
+			terms[0].push_back(literal(std::bit_cast<uint64_t>(constant), m_precision));
+		}
+		if (terms[1].empty()) return balance(std::move(terms[0]), additive ? Binop::Add : Binop::Multiply);
+		Result subtracted = balance(std::move(terms[1]), Binop::Add);
+		if (terms[0].empty()) return simplifyUnop(NewNode, ExpressionNode::Unop::Negate, subtracted);
+		return simplifyBinop(NewNode, Binop::Subtract, balance(std::move(terms[0]), Binop::Add), subtracted);
+	}
+
+	Simplifier::Result Simplifier::simplifyUnop(size_t i, ExpressionNode::Unop op, Result operand) {
+		using Unop = ExpressionNode::Unop;
+		if (op == Unop::IToF) return isFloat(operand.type) ? operand : convert(operand, m_precision);
+		if (op == Unop::FToI) return convert(operand, DataType::Integer);
+
+		// Negate and Abs keep integers, the rest only exist for floats.
+		DataType type = op == Unop::Negate || op == Unop::Abs ? operand.type : m_precision;
+		operand = convert(operand, type);
+
+		if (operand.constant) {
+			if (type == DataType::Integer) {
+				int64_t v = (int64_t)operand.value;
+				switch (op) {
+					case Unop::Negate: return literal(0 - operand.value, type);
+					case Unop::Abs: return literal(v < 0 ? 0 - operand.value : operand.value, type);
+					default: break;
+				}
+			}
+			else {
+				constexpr uint64_t sign = 0x8000000000000000;
+				double v = std::bit_cast<double>(operand.value);
+				switch (op) {
+					case Unop::Negate: return literal(operand.value ^ sign, type);
+					case Unop::Abs: return literal(operand.value & ~sign, type);
+					case Unop::Sin: return literal(std::bit_cast<uint64_t>(std::sin(v)), type);
+					case Unop::Cos: return literal(std::bit_cast<uint64_t>(std::cos(v)), type);
+					case Unop::Floor: return literal(std::bit_cast<uint64_t>(std::floor(v)), type);
+					default: break;
+				}
+			}
+		}
+
+		ExpressionNode inner = m_expr[operand.node];
+		if (inner.type == ExpressionNode::Type::Unop) {
+			if (op == Unop::Negate && inner.unop.op == Unop::Negate) return { inner.unop.operand, type, false, 0 };
+			if (op == Unop::Abs && inner.unop.op == Unop::Negate) return node(ExpressionNode::makeUnop(Unop::Abs, inner.unop.operand), type);
+			if (op == inner.unop.op && ( op == Unop::Abs || op == Unop::Floor )) return operand;
+		}
+
+		if (i != NewNode && m_expr[i].unop.operand == operand.node) return { i, type, false, 0 };
+		return node(ExpressionNode::makeUnop(op, operand.node), type);
+	}
+}
\ No newline at end of file
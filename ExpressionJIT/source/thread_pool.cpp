@@ -0,0 +1,128 @@
+#include "include/exprjit/thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace exprjit
+{
+	static uint64_t bounds(uint64_t begin, uint64_t end) noexcept {
+		return begin | end << 32;
+	}
+
+	ThreadPool::ThreadPool() : ThreadPool(Options {}) { }
+
+	ThreadPool::ThreadPool(const Options& options)
+		: m_ranges(options.threads > 0 ? options.threads : std::max<unsigned>(std::thread::hardware_concurrency(), 1)), m_pin(options.pin) {
+		m_workers.reserve(m_ranges.size() - 1);
+		for (size_t t = 1; t < m_ranges.size(); ++t) m_workers.emplace_back(&ThreadPool::worker, this, t);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& worker : m_workers) worker.join();
+	}
+
+	void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+		if (count == 0) return;
+		if (count > UINT32_MAX) throw std::invalid_argument("Too many tasks for one run.");
+		std::lock_guard runLock(m_runMutex);
+		size_t n = m_ranges.size();
+		for (size_t t = 0; t < n; ++t) m_ranges[t].bounds.store(bounds(count * t / n, count * ( t + 1 ) / n), std::memory_order_relaxed);
+		if (!m_workers.empty()) {
+			{
+				std::lock_guard lock(m_mutex);
+				m_task = &task;
+				m_busy = m_workers.size();
+				++m_generation;
+			}
+			m_wake.notify_all();
+		}
+		else m_task = &task;
+
+		work(0);
+
+		std::unique_lock lock(m_mutex);
+		m_done.wait(lock, [this] { return m_busy == 0; });
+		m_task = nullptr;
+	}
+
+	void ThreadPool::worker(size_t thread) {
+		if (m_pin) pin(thread);
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock lock(m_mutex);
+				m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+				if (m_stop) return;
+				seen = m_generation;
+			}
+			work(thread);
+			std::lock_guard lock(m_mutex);
+			if (--m_busy == 0) m_done.notify_one();
+		}
+	}
+
+	// Own tasks first, then stolen ones until no thread has any left. Tasks being run are not in any range,
+	// so every thread returns once the last ones have been taken.
+	void ThreadPool::work(size_t thread) {
+		size_t n = m_ranges.size(), task;
+		while (true) {
+			while (take(thread, task)) ( *m_task )( task );
+			bool stolen = false;
+			for (size_t k = 1; k < n && !stolen; ++k) stolen = steal(thread, ( thread + k ) % n);
+			if (!stolen) return;
+		}
+	}
+
+	bool ThreadPool::take(size_t thread, size_t& task) noexcept {
+		std::atomic<uint64_t>& range = m_ranges[thread].bounds;
+		uint64_t current = range.load(std::memory_order_acquire);
+		while (true) {
+			uint64_t begin = (uint32_t)current, end = current >> 32;
+			if (begin >= end) return false;
+			if (range.compare_exchange_weak(current, bounds(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire)) {
+				task = begin;
+				return true;
+			}
+		}
+	}
+
+	// Moves the upper half of the victim's tasks, the last one included, to the empty range of the thief.
+	// A task index is never put back once taken, so a stale range can not match a current one.
+	bool ThreadPool::steal(size_t thread, size_t victim) noexcept {
+		std::atomic<uint64_t>& range = m_ranges[victim].bounds;
+		uint64_t current = range.load(std::memory_order_acquire);
+		while (true) {
+			uint64_t begin = (uint32_t)current, end = current >> 32;
+			if (begin >= end) return false;
+			uint64_t middle = begin + ( end - begin ) / 2;
+			if (range.compare_exchange_weak(current, bounds(begin, middle), std::memory_order_acq_rel, std::memory_order_acquire)) {
+				m_ranges[thread].bounds.store(bounds(middle, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+
+	void ThreadPool::pin(size_t thread) noexcept {
+		size_t processor = thread % std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+#ifdef _WIN32
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << processor % ( sizeof(DWORD_PTR) * 8 ));
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(processor % CPU_SETSIZE, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+		(void)processor;
+#endif
+	}
+}
\ No newline at end of file